@@ -0,0 +1,104 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <catch.hpp>
+
+#include "core/audio/processor.hpp"
+#include "services/application.hpp"
+#include "services/audio_manager.hpp"
+
+/// Micro benchmarks for the engines and the core utilities they use.
+///
+/// Each benchmark runs a block function a fixed number of times, after a short warmup, and
+/// reports the time per sample, and the number of heap allocations per block. Anything above 0
+/// allocations per block is a bug on the audio thread.
+namespace otto::bench {
+
+  /// The buffer sizes every engine is measured at
+  inline constexpr std::array<int, 3> buffer_sizes = {64, 256, 1024};
+
+  /// The number of heap allocations made on any thread so far
+  ///
+  /// Counted by the replacement `operator new` in main.cpp. Includes the audio worker threads.
+  long allocation_count() noexcept;
+
+  /// An audio manager without a driver, where the buffer size can be changed between benchmarks
+  struct BenchAudioManager final : services::AudioManager {
+    BenchAudioManager(int samplerate = 48000);
+
+    /// Engines size their buffers when they are constructed, so construct them after this
+    void set_buffer_size(int buffer_size);
+
+    /// Processing only happens on the benchmark thread
+    void wait_one() const noexcept override {}
+
+    static BenchAudioManager& current() noexcept
+    {
+      return static_cast<BenchAudioManager&>(AudioManager::current());
+    }
+  };
+
+  struct Result {
+    std::string name;
+    int nframes = 0;
+    /// The load: active voices, held notes for sequencers, or connected slots for signals. 0 if
+    /// it doesn't apply
+    int voices = 0;
+    double ns_per_sample = 0;
+    /// 99th percentile of the block times, per sample
+    double ns_per_sample_p99 = 0;
+    double allocations_per_block = 0;
+  };
+
+  /// Print a result, and store it for the csv report
+  void report(const Result& result);
+
+  /// All results reported so far
+  const std::vector<Result>& results() noexcept;
+
+  /// A buffer of deterministic noise, to use as input to effects
+  void fill_noise(core::audio::AudioBufferHandle& buffer, unsigned seed = 1) noexcept;
+
+  /// Measure `block(nframes)`
+  ///
+  /// The number of blocks is chosen so every benchmark processes roughly the same amount of
+  /// audio, independent of the buffer size.
+  template<typename Block>
+  Result run(std::string name, int nframes, int voices, Block&& block)
+  {
+    using clock = std::chrono::steady_clock;
+    constexpr int warmup_blocks = 16;
+    const int blocks = std::max(64, (1 << 18) / nframes);
+
+    for (int i = 0; i < warmup_blocks; i++) block(nframes);
+
+    std::vector<double> block_ns;
+    block_ns.reserve(blocks);
+    long allocations = 0;
+    for (int i = 0; i < blocks; i++) {
+      long allocs_before = allocation_count();
+      auto t0 = clock::now();
+      block(nframes);
+      auto t1 = clock::now();
+      allocations += allocation_count() - allocs_before;
+      block_ns.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count());
+    }
+
+    std::sort(block_ns.begin(), block_ns.end());
+    Result res;
+    res.name = std::move(name);
+    res.nframes = nframes;
+    res.voices = voices;
+    res.ns_per_sample = block_ns[block_ns.size() / 2] / nframes;
+    res.ns_per_sample_p99 = block_ns[(block_ns.size() - 1) * 99 / 100] / nframes;
+    res.allocations_per_block = double(allocations) / blocks;
+    report(res);
+    return res;
+  }
+
+} // namespace otto::bench
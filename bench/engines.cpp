@@ -0,0 +1,237 @@
+#include "bench.hpp"
+
+#include <fmt/format.h>
+
+#include "engines/fx/chorus/chorus.hpp"
+#include "engines/fx/wormhole/wormhole.hpp"
+#include "engines/misc/master/master.hpp"
+#include "engines/misc/sends/sends.hpp"
+#include "engines/seq/arp/arp.hpp"
+#include "engines/seq/euclid/euclid.hpp"
+#include "engines/synths/OTTOFM/ottofm.hpp"
+#include "engines/synths/goss/goss.hpp"
+#include "engines/synths/potion/potion.hpp"
+#include "engines/synths/rhodes/rhodes.hpp"
+
+#include "core/engine/routing_graph.hpp"
+#include "services/engine_manager.hpp"
+
+namespace otto::bench {
+
+  using namespace core;
+
+  namespace {
+    audio::AudioBufferPool& pool()
+    {
+      return BenchAudioManager::current().buffer_pool();
+    }
+
+    /// The key of note `i`: fifths apart, folded into 36..120, so the first 85 are all different
+    /// and all valid midi keys
+    int key(int i)
+    {
+      return 36 + (7 * i) % 85;
+    }
+
+    /// Notes spread over a few octaves, so voices don't share a frequency
+    void note_ons(midi::MidiEventBuffer& midi, int count)
+    {
+      for (int i = 0; i < count; i++) midi.push_back(midi::NoteOnEvent(key(i)));
+    }
+
+    void note_offs(midi::MidiEventBuffer& midi, int count)
+    {
+      for (int i = 0; i < count; i++) midi.push_back(midi::NoteOffEvent(key(i)));
+    }
+
+    /// Measure a synth at every buffer size, with one voice, the default voice count, and all
+    /// the voices it allocates
+    ///
+    /// The voice count is set to the number of notes. The notes are started in the first warmup
+    /// block, and held for the rest of the benchmark. With all voices playing, it is also
+    /// measured without the worker pool.
+    template<typename Engine>
+    void bench_synth()
+    {
+      auto& workers = BenchAudioManager::current().worker_pool();
+      for (int bs : buffer_sizes) {
+        BenchAudioManager::current().set_buffer_size(bs);
+        auto max_voices = Engine().voice_mgr().max_voice_count();
+        for (int voices : {1, 6, max_voices}) {
+          for (bool parallel : {true, false}) {
+            if (!parallel && voices != max_voices) continue;
+            workers.enabled(parallel);
+            Engine engine;
+            engine.voice_mgr().voice_count(voices);
+            midi::MidiEventBuffer midi;
+            note_ons(midi, voices);
+            auto name = fmt::format("{}{}", Engine::name.c_str(), parallel ? "" : " (serial)");
+            run(name, bs, voices, [&](int nframes) {
+              engine.process({pool().allocate_clear(), midi, nframes});
+              midi.clear();
+            });
+          }
+        }
+      }
+      workers.enabled(true);
+    }
+
+    template<typename Engine>
+    void bench_effect()
+    {
+      for (int bs : buffer_sizes) {
+        BenchAudioManager::current().set_buffer_size(bs);
+        Engine engine;
+        auto input = pool().allocate();
+        fill_noise(input);
+        run(Engine::name.c_str(), bs, 0, [&](int nframes) {
+          engine.process(audio::ProcessData<1>(input));
+        });
+      }
+    }
+
+    /// Measure a sequencer, holding 1, 3 and 6 notes
+    template<typename Engine>
+    void bench_sequencer()
+    {
+      for (int bs : buffer_sizes) {
+        BenchAudioManager::current().set_buffer_size(bs);
+        for (int notes : {1, 3, 6}) {
+          Engine engine;
+          midi::MidiEventBuffer midi;
+          note_ons(midi, notes);
+          run(Engine::name.c_str(), bs, notes, [&](int nframes) {
+            engine.process({midi, nframes});
+            midi.clear();
+          });
+        }
+      }
+    }
+  } // namespace
+
+  TEST_CASE ("Synths", "[engines][synths]") {
+    SECTION ("Goss") {
+      bench_synth<engines::GossSynth>();
+    }
+    SECTION ("Rhodes") {
+      bench_synth<engines::RhodesSynth>();
+    }
+    SECTION ("Potion") {
+      bench_synth<engines::PotionSynth>();
+    }
+    SECTION ("OTTO.FM") {
+      bench_synth<engines::OTTOFMSynth>();
+    }
+    SECTION ("OTTO.FM oversampling") {
+      // The default voice count at each quality setting, to see what the tiers cost
+      for (int bs : buffer_sizes) {
+        BenchAudioManager::current().set_buffer_size(bs);
+        for (int quality : {0, 1, 2}) {
+          engines::OTTOFMSynth engine;
+          engine.props.quality = quality;
+          midi::MidiEventBuffer midi;
+          note_ons(midi, 6);
+          run(fmt::format("OTTO.FM {}x", 1 << quality), bs, 6, [&](int nframes) {
+            engine.process({pool().allocate_clear(), midi, nframes});
+            midi.clear();
+          });
+        }
+      }
+    }
+  }
+
+  TEST_CASE ("Effects", "[engines][effects]") {
+    SECTION ("Wormhole") {
+      bench_effect<engines::Wormhole>();
+    }
+    SECTION ("Chorus") {
+      bench_effect<engines::Chorus>();
+    }
+  }
+
+  TEST_CASE ("Sequencers", "[engines][sequencers]") {
+    SECTION ("Arp") {
+      bench_sequencer<engines::Arp>();
+    }
+    SECTION ("Euclid") {
+      bench_sequencer<engines::Euclid>();
+    }
+  }
+
+  TEST_CASE ("Misc engines", "[engines][misc]") {
+    SECTION ("Master") {
+      for (int bs : buffer_sizes) {
+        BenchAudioManager::current().set_buffer_size(bs);
+        engines::Master master;
+        auto input = pool().allocate_multi<2>();
+        fill_noise(input[0], 1);
+        fill_noise(input[1], 2);
+        // Keep the volume moving, so the smoother is measured too
+        bool up = false;
+        run("Master", bs, 0, [&](int nframes) {
+          master.props.volume = (up = !up) ? 1.f : 0.5f;
+          master.process(audio::ProcessData<2>(input));
+        });
+      }
+    }
+
+    SECTION ("Routing graph") {
+      // The sends of the engine chain, with effects that pass their input through, so only the
+      // mixing is measured
+      for (int bs : buffer_sizes) {
+        BenchAudioManager::current().set_buffer_size(bs);
+        engines::Sends sends;
+        sends.props.to_FX1 = 0.5;
+        sends.props.to_FX2 = 0.3;
+        engine::RoutingGraph graph;
+        auto in = graph.add_input("In");
+        auto through = [](auto& in, auto& out, auto) { out.audio = {in.audio[0], in.audio[0]}; };
+        auto fx1 = graph.add_node("FX1", 1, 2, through);
+        auto fx2 = graph.add_node("FX2", 1, 2, through);
+        auto out = graph.add_node("Out", 2, 2, [](auto& in, auto& out, auto) { out = in; });
+        graph.connect(in, fx1, &sends.props.to_FX1);
+        graph.connect(in, fx2, &sends.props.to_FX2);
+        graph.connect(in, out, &sends.props.dry, &sends.props.dry_pan);
+        graph.connect(fx1, out);
+        graph.connect(fx2, out);
+        graph.output(out);
+        graph.compile();
+        auto input = pool().allocate();
+        fill_noise(input);
+        midi::MidiEventBuffer midi;
+        run("Routing graph", bs, 0, [&](int nframes) {
+          graph.process({input, midi, nframes});
+        });
+      }
+    }
+  }
+
+  TEST_CASE ("Engine chain", "[engines][chain]") {
+    // The whole EngineManager::process, as the audio driver calls it, with a Wormhole in both
+    // effect slots
+    auto& engine_manager = *Application::current().engine_manager;
+    auto& workers = BenchAudioManager::current().worker_pool();
+    engine_manager.select("Effect1", "Wormhole");
+    engine_manager.select("Effect2", "Wormhole");
+    for (bool parallel : {false, true}) {
+      workers.enabled(parallel);
+      auto name = parallel ? fmt::format("EngineManager ({} workers)", workers.size())
+                           : std::string("EngineManager (serial)");
+      for (int bs : buffer_sizes) {
+        BenchAudioManager::current().set_buffer_size(bs);
+        for (int voices : {1, 6}) {
+          midi::MidiEventBuffer midi;
+          note_ons(midi, voices);
+          run(name, bs, voices, [&](int nframes) {
+            engine_manager.process({pool().allocate_clear(), midi, nframes});
+            midi.clear();
+          });
+          note_offs(midi, voices);
+          engine_manager.process({pool().allocate_clear(), midi, bs});
+        }
+      }
+    }
+    workers.enabled(true);
+  }
+
+} // namespace otto::bench
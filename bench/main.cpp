@@ -0,0 +1,213 @@
+#define CATCH_CONFIG_RUNNER
+#include "bench.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+
+#include <Gamma/Domain.h>
+#include <fmt/format.h>
+
+#include "services/clock_manager.hpp"
+#include "services/controller.hpp"
+#include "services/engine_manager.hpp"
+#include "services/log_manager.hpp"
+#include "services/preset_manager.hpp"
+#include "services/state_manager.hpp"
+#include "services/ui_manager.hpp"
+
+// Allocation counting //////////////////////////////////////////////////////
+
+namespace {
+  /// Counted on every thread, as the audio worker threads render parts of each block
+  std::atomic<long> allocations = 0;
+
+  void* counted_alloc(std::size_t size)
+  {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size ? size : 1)) return ptr;
+    throw std::bad_alloc();
+  }
+
+  void* counted_aligned_alloc(std::size_t size, std::align_val_t align)
+  {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    auto al = static_cast<std::size_t>(align);
+    // aligned_alloc requires the size to be a multiple of the alignment
+    if (void* ptr = std::aligned_alloc(al, (size + al - 1) / al * al)) return ptr;
+    throw std::bad_alloc();
+  }
+} // namespace
+
+void* operator new(std::size_t size)
+{
+  return counted_alloc(size);
+}
+
+void* operator new[](std::size_t size)
+{
+  return counted_alloc(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t align)
+{
+  return counted_aligned_alloc(size, align);
+}
+
+void* operator new[](std::size_t size, std::align_val_t align)
+{
+  return counted_aligned_alloc(size, align);
+}
+
+void operator delete(void* ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept
+{
+  std::free(ptr);
+}
+
+namespace otto::bench {
+
+  using namespace services;
+
+  long allocation_count() noexcept
+  {
+    return allocations.load(std::memory_order_relaxed);
+  }
+
+  // BenchAudioManager ////////////////////////////////////////////////////////
+
+  BenchAudioManager::BenchAudioManager(int samplerate)
+  {
+    _samplerate = samplerate;
+    gam::sampleRate(samplerate);
+    set_buffer_size(256);
+  }
+
+  void BenchAudioManager::set_buffer_size(int buffer_size)
+  {
+    _buffer_size = buffer_size;
+    buffer_pool().set_buffer_size(buffer_size);
+    events.buffer_size_change.fire(buffer_size);
+  }
+
+  // Reporting ////////////////////////////////////////////////////////////////
+
+  static std::vector<Result> all_results;
+
+  void report(const Result& res)
+  {
+    fmt::print(" {:<32} {:>6} {:>6} {:>12.2f} {:>12.2f} {:>10.2f}\n", res.name, res.nframes,
+               res.voices > 0 ? std::to_string(res.voices) : "-", res.ns_per_sample,
+               res.ns_per_sample_p99, res.allocations_per_block);
+    all_results.push_back(res);
+  }
+
+  const std::vector<Result>& results() noexcept
+  {
+    return all_results;
+  }
+
+  void fill_noise(core::audio::AudioBufferHandle& buffer, unsigned seed) noexcept
+  {
+    // A small LCG, so the input is the same on every run and platform
+    for (auto& s : buffer) {
+      seed = seed * 1664525u + 1013904223u;
+      s = (seed >> 8) / float(1 << 23) - 1.f;
+    }
+  }
+
+  void write_csv(const std::string& path)
+  {
+    std::ofstream file{path};
+    file << "name,frames,voices,ns_per_sample,ns_per_sample_p99,allocations_per_block\n";
+    for (auto& res : all_results) {
+      file << fmt::format("\"{}\",{},{},{:.3f},{:.3f},{:.3f}\n", res.name, res.nframes,
+                          res.voices, res.ns_per_sample, res.ns_per_sample_p99,
+                          res.allocations_per_block);
+    }
+  }
+
+  // Services /////////////////////////////////////////////////////////////////
+
+  /// Nothing is loaded or saved, so every run starts from the default engine settings
+  struct BenchStateManager final : StateManager {
+    void load() override {}
+    void save() override {}
+    void attach(std::string name, Loader load, Saver save) override {}
+    void detach(std::string name) override {}
+  };
+
+  struct DummyUIManager final : UIManager {
+    void main_ui_loop() override {}
+  };
+
+} // namespace otto::bench
+
+int main(int argc, char* argv[])
+{
+  using namespace otto;
+  using namespace otto::services;
+
+  Catch::Session session;
+  std::string csv_path;
+  session.cli(session.cli() |
+              Catch::clara::Opt(csv_path, "file")["--csv"]("Also write the results to a csv file"));
+  if (int res = session.applyCommandLine(argc, argv); res != 0) return res;
+
+  // Keep the catch arguments away from loguru
+  int log_argc = 1;
+  Application app{[&] { return std::make_unique<LogManager>(log_argc, argv); },
+                  std::make_unique<bench::BenchStateManager>,
+                  std::make_unique<PresetManager>,
+                  [] { return std::make_unique<bench::BenchAudioManager>(); },
+                  ClockManager::create_default,
+                  std::make_unique<bench::DummyUIManager>,
+                  Controller::make_dummy,
+                  EngineManager::create_default};
+  app.engine_manager->start();
+  app.audio_manager->start();
+
+  fmt::print(" {:<32} {:>6} {:>6} {:>12} {:>12} {:>10}\n", "benchmark", "frames", "voices",
+             "ns/sample", "p99", "allocs");
+
+  int result = session.run();
+
+  if (!csv_path.empty()) bench::write_csv(csv_path);
+
+  return (result < 0xff ? result : 0xff);
+}
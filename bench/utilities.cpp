@@ -0,0 +1,81 @@
+#include "bench.hpp"
+
+#include "core/props/props.hpp"
+
+#include "util/iterator.hpp"
+#include "util/signals.hpp"
+
+// For these, a "sample" is a single operation, so ns/sample is the time per operation
+
+namespace otto::bench {
+
+  using namespace core;
+
+  TEST_CASE ("util::zip", "[util]") {
+    for (int bs : buffer_sizes) {
+      BenchAudioManager::current().set_buffer_size(bs);
+      auto& pool = BenchAudioManager::current().buffer_pool();
+      auto in = pool.allocate_multi<2>();
+      auto out = pool.allocate();
+      fill_noise(in[0], 1);
+      fill_noise(in[1], 2);
+
+      run("zip", bs, 0, [&](int nframes) {
+        for (auto&& [a, b, o] : util::zip(in[0], in[1], out)) {
+          o = a * 0.5f + b;
+        }
+      });
+
+      // The same loop, without zip, to see what the abstraction costs
+      run("zip (indexed reference)", bs, 0, [&](int nframes) {
+        for (int i = 0; i < nframes; i++) {
+          out[i] = in[0][i] * 0.5f + in[1][i];
+        }
+      });
+    }
+  }
+
+  TEST_CASE ("AudioBufferPool::allocate", "[util]") {
+    constexpr int ops = 1024;
+    audio::AudioBufferPool pool{256};
+
+    run("AudioBufferPool::allocate", ops, 0, [&](int n) {
+      for (int i = 0; i < n; i++) {
+        auto buf = pool.allocate();
+      }
+    });
+
+    // Allocate from a pool where most buffers are already in use, like at the end of the chain
+    auto held = pool.allocate_multi<audio::AudioBufferPool::default_capacity - 1>();
+    run("AudioBufferPool::allocate (7 in use)", ops, 0, [&](int n) {
+      for (int i = 0; i < n; i++) {
+        auto buf = pool.allocate();
+      }
+    });
+  }
+
+  TEST_CASE ("Signal::emit", "[util]") {
+    constexpr int ops = 1024;
+    float sum = 0;
+
+    for (int slots : {1, 4}) {
+      util::Signal<float> signal;
+      for (int i = 0; i < slots; i++) {
+        signal.connect([&](float f) { sum += f; });
+      }
+      run("Signal::emit", ops, slots, [&](int n) {
+        for (int i = 0; i < n; i++) signal.emit(float(i));
+      });
+    }
+
+    // Setting a property runs the hooks and the on_change signal
+    props::Property<float> prop = {0, props::limits(0, 1)};
+    prop.on_change().connect([&](float f) { sum += f; });
+    run("Property::set", ops, 1, [&](int n) {
+      for (int i = 0; i < n; i++) prop = (i & 1) ? 0.25f : 0.75f;
+    });
+
+    REQUIRE(sum != 0);
+  }
+
+} // namespace otto::bench
@@ -20,6 +20,8 @@ namespace otto::service::audio {
     void shutdown();
 
     std::atomic_int samplerate;
+    /// Number of xruns reported by jack
+    std::atomic_int xruns = 0;
 
     void send_midi_event(core::midi::AnyMidiEvent) noexcept;
 
@@ -46,7 +48,7 @@ namespace otto::service::audio {
     jack_client_t* client;
     jack_status_t jackStatus;
 
-    util::atomic_swap<core::midi::shared_vector<core::midi::AnyMidiEvent>> midi_bufs = {{}, {}};
+    util::atomic_swap<core::midi::MidiEventBuffer> midi_bufs;
 
     enum class PortType {
       Audio,
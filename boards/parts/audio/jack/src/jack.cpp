@@ -90,6 +90,14 @@ namespace otto::service::audio {
       },
       this);
 
+    jack_set_xrun_callback(
+      client,
+      [](void* arg) {
+        (static_cast<JackAudioDriver*>(arg))->xruns++;
+        return 0;
+      },
+      this);
+
     jack_on_shutdown(client, jackShutdown, nullptr);
 
     bufferSize = jack_get_buffer_size(client);
@@ -305,7 +313,7 @@ namespace otto::service::audio {
     float* outRData = (float*) jack_port_get_buffer(ports.outR, nframes);
     float* inData = (float*) jack_port_get_buffer(ports.input, nframes);
 
-    int ref_count = 0;
+    std::atomic_int ref_count = 0;
     auto in_buf = AudioBufferHandle(inData, nframes, ref_count);
     auto out_data =
       engines::process({in_buf,
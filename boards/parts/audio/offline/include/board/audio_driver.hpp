@@ -0,0 +1,63 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include <gsl/span>
+
+#include "core/audio/midi.hpp"
+#include "services/audio_manager.hpp"
+
+namespace otto::services {
+
+  /// A midi event, and the frame at which it should be played
+  struct ScheduledMidiEvent {
+    long frame = 0;
+    core::midi::AnyMidiEvent event;
+  };
+
+  /// Renders audio as fast as possible, without a sound card
+  ///
+  /// Instead of being driven by an audio callback, this pulls
+  /// {@ref EngineManager::process} in a loop from {@ref render}. Used to bounce patches to disk,
+  /// and to benchmark engines.
+  struct OfflineAudioManager final : AudioManager {
+    /// Timing of a call to {@ref render}
+    struct Stats {
+      long frames = 0;
+      int blocks = 0;
+      /// Wall clock time spent in `EngineManager::process`, in seconds
+      double process_seconds = 0;
+      /// CPU time used by the process during the render, in seconds
+      double cpu_seconds = 0;
+      /// Wall clock time of each block, in microseconds
+      std::vector<float> block_us;
+
+      /// Length of the rendered audio, in seconds
+      double audio_seconds(int samplerate) const noexcept;
+
+      /// How many times faster than realtime the engines ran
+      double realtime_factor(int samplerate) const noexcept;
+
+      /// The `p`th percentile of the block times, in microseconds. `p` is in `[0, 100]`
+      float block_percentile(float p) const;
+    };
+
+    using Output = std::array<std::vector<float>, 2>;
+
+    OfflineAudioManager(int samplerate = 48000, int buffer_size = 256);
+
+    /// Processing only happens inside {@ref render}, on the calling thread, so there is never a
+    /// process call to wait for.
+    void wait_one() const noexcept override {}
+
+    /// Render `nframes` frames of audio, and append it to `output`
+    ///
+    /// @param events the midi events to play, sorted by frame. Frame 0 is the start of this
+    /// render.
+    Stats render(long nframes, gsl::span<const ScheduledMidiEvent> events, Output& output);
+  };
+
+} // namespace otto::services
+
+// kak: other_file=../../src/audio_driver.cpp
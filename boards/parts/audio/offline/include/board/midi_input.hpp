@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vector>
+
+#include "util/filesystem.hpp"
+
+#include "board/audio_driver.hpp"
+
+namespace otto::services {
+
+  /// Read an event script, and convert the times to frames.
+  ///
+  /// Each line is an event, on the form `<seconds> <command> <args...>`, where command is one of
+  ///
+  ///  - `on <note> [velocity] [channel]` - note is a number, or a name like `C4`. Velocity is
+  ///    0-127, and defaults to 127
+  ///  - `off <note> [channel]`
+  ///  - `cc <controller> <value> [channel]`
+  ///  - `bend <value> [channel]` - value is 0-16383, with 8192 as the center
+  ///
+  /// Empty lines, and everything after a `#`, are ignored.
+  ///
+  /// \returns the events, sorted by frame
+  /// \throws util::exception on syntax errors, or if the file can't be read
+  std::vector<ScheduledMidiEvent> read_event_script(const fs::path& path, int samplerate);
+
+  /// Read a standard midi file (type 0 or 1), and convert the times to frames.
+  ///
+  /// All tracks are merged, and tempo changes are followed. Only note, control change and pitch
+  /// bend events are kept.
+  ///
+  /// \returns the events, sorted by frame
+  /// \throws util::exception if the file is invalid, or can't be read
+  std::vector<ScheduledMidiEvent> read_midi_file(const fs::path& path, int samplerate);
+
+} // namespace otto::services
+
+// kak: other_file=../../src/midi_input.cpp
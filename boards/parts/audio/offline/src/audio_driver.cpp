@@ -0,0 +1,102 @@
+#include "board/audio_driver.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+
+#include <Gamma/Domain.h>
+
+#include "core/props/change_queue.hpp"
+
+#include "services/engine_manager.hpp"
+#include "services/log_manager.hpp"
+
+namespace otto::services {
+
+  using clock = std::chrono::high_resolution_clock;
+
+  double OfflineAudioManager::Stats::audio_seconds(int samplerate) const noexcept
+  {
+    return double(frames) / samplerate;
+  }
+
+  double OfflineAudioManager::Stats::realtime_factor(int samplerate) const noexcept
+  {
+    if (process_seconds == 0) return 0;
+    return audio_seconds(samplerate) / process_seconds;
+  }
+
+  float OfflineAudioManager::Stats::block_percentile(float p) const
+  {
+    if (block_us.empty()) return 0;
+    auto sorted = block_us;
+    auto idx = std::lround((sorted.size() - 1) * std::clamp(p, 0.f, 100.f) / 100.f);
+    std::nth_element(sorted.begin(), sorted.begin() + idx, sorted.end());
+    return sorted[idx];
+  }
+
+  OfflineAudioManager::OfflineAudioManager(int samplerate, int buffer_size)
+  {
+    _samplerate = samplerate;
+    _buffer_size = buffer_size;
+    buffer_pool().set_buffer_size(buffer_size);
+    events.buffer_size_change.fire(buffer_size);
+    gam::sampleRate(samplerate);
+  }
+
+  auto OfflineAudioManager::render(long nframes,
+                                   gsl::span<const ScheduledMidiEvent> events,
+                                   Output& output) -> Stats
+  {
+    Stats stats;
+    int bs = buffer_size();
+    stats.block_us.reserve(nframes / bs + 1);
+    for (auto& channel : output) channel.reserve(channel.size() + nframes);
+
+    auto next_event = events.begin();
+    std::clock_t cpu_start = std::clock();
+
+    // Always process whole blocks, and discard the extra frames at the end.
+    for (long pos = 0; pos < nframes; pos += bs) {
+      if (!running() || !Application::current().running()) break;
+      _buffer_number++;
+
+      core::props::ChangeQueue::current().apply_all();
+
+      auto& midi = collect_midi_events();
+      for (; next_event != events.end() && next_event->frame < pos + bs; ++next_event) {
+        auto evt = next_event->event;
+        util::match(evt, [&](core::midi::MidiEvent& e) {
+          e.time = std::max<long>(next_event->frame - pos, 0);
+        });
+        midi.push_back(evt);
+      }
+      LOGW_IF(midi.dropped() > 0, "Dropped {} midi events at frame {}", midi.dropped(), pos);
+
+      auto in_buf = buffer_pool().allocate_clear();
+
+      auto t0 = clock::now();
+      auto out = Application::current().engine_manager->process({in_buf, midi, bs});
+      auto t1 = clock::now();
+
+      auto length = std::min<long>(bs, nframes - pos);
+      for (int ch = 0; ch < 2; ch++) {
+        output[ch].insert(output[ch].end(), out.audio[ch].begin(), out.audio[ch].begin() + length);
+      }
+
+      auto us = std::chrono::duration<float, std::micro>(t1 - t0).count();
+      stats.block_us.push_back(us);
+      stats.process_seconds += us / 1e6;
+      stats.frames += length;
+      stats.blocks++;
+      record_block(t1 - t0, bs);
+    }
+
+    stats.cpu_seconds = double(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+    return stats;
+  }
+
+} // namespace otto::services
+
+// kak: other_file=../include/board/audio_driver.hpp
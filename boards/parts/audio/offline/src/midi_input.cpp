@@ -0,0 +1,255 @@
+#include "board/midi_input.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cmath>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+#include "core/audio/midi.hpp"
+#include "util/exception.hpp"
+
+namespace otto::services {
+
+  using byte = unsigned char;
+
+  namespace {
+    long to_frames(double seconds, int samplerate)
+    {
+      return std::lround(seconds * samplerate);
+    }
+
+    void sort_by_frame(std::vector<ScheduledMidiEvent>& events)
+    {
+      std::stable_sort(events.begin(), events.end(),
+                       [](auto& lhs, auto& rhs) { return lhs.frame < rhs.frame; });
+    }
+
+    int parse_note(const std::string& str)
+    {
+      if (!str.empty() && (std::isdigit(str[0]) || str[0] == '-')) return std::stoi(str);
+      return core::midi::note_number(str);
+    }
+
+    byte status(int type, int channel)
+    {
+      return byte((type << 4) | (std::clamp(channel, 0, 15)));
+    }
+  } // namespace
+
+  std::vector<ScheduledMidiEvent> read_event_script(const fs::path& path, int samplerate)
+  {
+    std::ifstream file{path.c_str()};
+    if (!file) throw util::exception("Could not open event script {}", path);
+
+    std::vector<ScheduledMidiEvent> res;
+    std::string line;
+    for (int line_nr = 1; std::getline(file, line); line_nr++) {
+      line = line.substr(0, line.find('#'));
+      std::istringstream words{line};
+      double time;
+      std::string command;
+      if (!(words >> time)) {
+        if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+        throw util::exception("{}:{}: Expected a time", path, line_nr);
+      }
+      if (!(words >> command)) throw util::exception("{}:{}: Expected a command", path, line_nr);
+      std::vector<std::string> args{std::istream_iterator<std::string>(words), {}};
+      auto arg = [&](std::size_t i, int def) {
+        if (i < args.size()) return std::stoi(args[i]);
+        if (def >= 0) return def;
+        throw util::exception("{}:{}: Missing argument {} for '{}'", path, line_nr, i + 1,
+                              command);
+      };
+
+      std::array<byte, 3> bytes;
+      try {
+        if (command == "on") {
+          int note = parse_note(args.empty() ? "" : args[0]);
+          if (note < 0 || note > 127) throw util::exception("Invalid note");
+          bytes = {status(0b1001, arg(2, 0)), byte(note), byte(std::clamp(arg(1, 127), 1, 127))};
+        } else if (command == "off") {
+          int note = parse_note(args.empty() ? "" : args[0]);
+          if (note < 0 || note > 127) throw util::exception("Invalid note");
+          bytes = {status(0b1000, arg(1, 0)), byte(note), 0};
+        } else if (command == "cc") {
+          bytes = {status(0b1011, arg(2, 0)), byte(arg(0, -1) & 0x7f), byte(arg(1, -1) & 0x7f)};
+        } else if (command == "bend") {
+          int value = std::clamp(arg(0, -1), 0, 16383);
+          bytes = {status(0b1110, arg(1, 0)), byte(value & 0x7f), byte(value >> 7)};
+        } else {
+          throw util::exception("Unknown command '{}'", command);
+        }
+      } catch (std::logic_error& e) {
+        // std::stoi errors
+        throw util::exception("{}:{}: Invalid number", path, line_nr);
+      } catch (util::exception& e) {
+        throw util::exception("{}:{}: {}", path, line_nr, e.what());
+      }
+      res.push_back({to_frames(time, samplerate), core::midi::from_bytes(bytes)});
+    }
+    sort_by_frame(res);
+    return res;
+  }
+
+  namespace {
+    /// A cursor into the bytes of a midi file
+    struct MidiReader {
+      const byte* pos;
+      const byte* end;
+
+      void require(std::size_t n) const
+      {
+        if (std::size_t(end - pos) < n) throw util::exception("Unexpected end of midi file");
+      }
+
+      byte u8()
+      {
+        require(1);
+        return *pos++;
+      }
+
+      int u16()
+      {
+        int hi = u8();
+        return (hi << 8) | u8();
+      }
+
+      long u32()
+      {
+        long hi = u16();
+        return (hi << 16) | u16();
+      }
+
+      long var_len()
+      {
+        long value = 0;
+        for (int i = 0; i < 4; i++) {
+          byte b = u8();
+          value = (value << 7) | (b & 0x7f);
+          if (!(b & 0x80)) return value;
+        }
+        throw util::exception("Invalid variable length quantity in midi file");
+      }
+
+      void expect(std::string_view tag)
+      {
+        require(tag.size());
+        if (!std::equal(tag.begin(), tag.end(), pos)) {
+          throw util::exception("Expected '{}' chunk in midi file", tag);
+        }
+        pos += tag.size();
+      }
+    };
+  } // namespace
+
+  std::vector<ScheduledMidiEvent> read_midi_file(const fs::path& path, int samplerate)
+  {
+    std::ifstream file{path.c_str(), std::ios::binary};
+    if (!file) throw util::exception("Could not open midi file {}", path);
+    std::vector<byte> data{std::istreambuf_iterator<char>(file), {}};
+
+    MidiReader reader{data.data(), data.data() + data.size()};
+    reader.expect("MThd");
+    if (reader.u32() < 6) throw util::exception("Invalid midi file header");
+    int format = reader.u16();
+    int ntracks = reader.u16();
+    int division = reader.u16();
+    if (format > 1) throw util::exception("Unsupported midi file format {}", format);
+
+    struct TickEvent {
+      long tick;
+      /// Microseconds per quarter note, for tempo changes. 0 for midi events
+      long tempo;
+      std::array<byte, 3> bytes;
+    };
+    std::vector<TickEvent> events;
+
+    for (int track = 0; track < ntracks; track++) {
+      reader.expect("MTrk");
+      long length = reader.u32();
+      reader.require(length);
+      MidiReader trk{reader.pos, reader.pos + length};
+      reader.pos += length;
+
+      long tick = 0;
+      byte running_status = 0;
+      while (trk.pos < trk.end) {
+        tick += trk.var_len();
+        trk.require(1);
+        byte status = *trk.pos;
+        if (status & 0x80) {
+          trk.pos++;
+        } else {
+          status = running_status;
+          if (!status) throw util::exception("Missing status byte in midi file");
+        }
+
+        if (status == 0xFF) {
+          // Meta event
+          byte type = trk.u8();
+          long len = trk.var_len();
+          trk.require(len);
+          if (type == 0x51 && len == 3) {
+            long tempo = (long(trk.pos[0]) << 16) | (trk.pos[1] << 8) | trk.pos[2];
+            events.push_back({tick, tempo, {}});
+          }
+          trk.pos += len;
+          if (type == 0x2F) break;
+          continue;
+        }
+        if (status == 0xF0 || status == 0xF7) {
+          // SysEx
+          long len = trk.var_len();
+          trk.require(len);
+          trk.pos += len;
+          continue;
+        }
+
+        running_status = status;
+        int type = status >> 4;
+        // Program change and channel pressure have a single data byte
+        int data_bytes = (type == 0xC || type == 0xD) ? 1 : 2;
+        std::array<byte, 3> bytes = {status, trk.u8(), 0};
+        if (data_bytes == 2) bytes[2] = trk.u8();
+        if (type == 0x8 || type == 0x9 || type == 0xB || type == 0xE) {
+          events.push_back({tick, 0, bytes});
+        }
+      }
+    }
+
+    std::stable_sort(events.begin(), events.end(), [](auto& lhs, auto& rhs) {
+      return lhs.tick < rhs.tick;
+    });
+
+    std::vector<ScheduledMidiEvent> res;
+    res.reserve(events.size());
+    // Convert ticks to seconds, following the tempo map
+    double seconds_per_tick;
+    if (division & 0x8000) {
+      // SMPTE: frames per second, and ticks per frame
+      int fps = -static_cast<signed char>(division >> 8);
+      seconds_per_tick = 1.0 / (fps * (division & 0xFF));
+    } else {
+      // Default tempo is 120 bpm
+      seconds_per_tick = 0.5 / division;
+    }
+    long last_tick = 0;
+    double seconds = 0;
+    for (auto& evt : events) {
+      seconds += (evt.tick - last_tick) * seconds_per_tick;
+      last_tick = evt.tick;
+      if (evt.tempo > 0) {
+        if (!(division & 0x8000)) seconds_per_tick = evt.tempo / 1e6 / division;
+        continue;
+      }
+      res.push_back({to_frames(seconds, samplerate), core::midi::from_bytes(evt.bytes)});
+    }
+    return res;
+  }
+
+} // namespace otto::services
+
+// kak: other_file=../include/board/midi_input.hpp
@@ -7,7 +7,6 @@
 
 #include "core/audio/midi.hpp"
 #include "core/audio/processor.hpp"
-#include "util/locked.hpp"
 
 #include <RtAudio.h>
 #include <RtMidi.h>
@@ -30,6 +29,12 @@ namespace otto::services {
     void init_audio();
     void init_midi();
 
+    /// Time at which the last process call started, in nanoseconds since the clock's epoch.
+    ///
+    /// Incoming midi is stamped relative to this, and played back at the same offset in the
+    /// next block. That trades one block of latency for sample accurate timing.
+    std::atomic<long long> block_start_ns_ = 0;
+
     RtAudio client;
     // optional is used to delay construction to the init phaase, where errros can be handled
     std::optional<RtMidiIn> midi_in = std::nullopt;
@@ -7,8 +7,11 @@
 #include <fmt/format.h>
 
 #include "util/algorithm.hpp"
+#include "util/audio.hpp"
+#include "util/timer.hpp"
 
 #include "core/audio/processor.hpp"
+#include "core/props/change_queue.hpp"
 
 #include "services/audio_manager.hpp"
 #include "services/engine_manager.hpp"
@@ -65,6 +68,7 @@ namespace otto::services {
                         this, &options);
       _buffer_size = buf_siz;
       buffer_pool().set_buffer_size(buf_siz);
+      events.buffer_size_change.fire(buf_siz);
       client.startStream();
       gam::sampleRate(samplerate());
     } catch (RtAudioError& e) {
@@ -102,11 +106,18 @@ namespace otto::services {
       }
     }
 
+    // RtMidi only gives us the time since the previous message, so the event is stamped with
+    // its arrival time relative to the start of the current block instead.
     midi_in->setCallback(
       [](double timeStamp, std::vector<unsigned char>* message, void* userData) {
         auto& self = *static_cast<RTAudioAudioManager*>(userData);
+        auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                     std::chrono::high_resolution_clock::now().time_since_epoch())
+                     .count();
+        auto offset = (now - self.block_start_ns_) * self.samplerate() / 1'000'000'000ll;
+        int time = std::clamp<long long>(offset, 0, self.buffer_size() - 1);
         try {
-          self.send_midi_event(core::midi::from_bytes(*message));
+          self.send_midi_event(core::midi::from_bytes(*message, time));
         } catch (util::exception& e) {
           LOGE("Error parsing midi: {}", e.what());
         }
@@ -123,6 +134,7 @@ namespace otto::services {
                                    RtAudioStreamStatus stream_status)
   {
     _buffer_number++;
+    if (stream_status & (RTAUDIO_INPUT_OVERFLOW | RTAUDIO_OUTPUT_UNDERFLOW)) _xruns++;
     auto running = this->running() && Application::current().running();
     if (!running) {
       return 0;
@@ -133,24 +145,27 @@ namespace otto::services {
       return 0;
     }
 
+    TIME_SCOPE("RtAudio::process");
     clock::time_point t0 = clock::now();
+    block_start_ns_ =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(t0.time_since_epoch()).count();
 
-    midi_bufs.swap();
+    // Run the on_change handlers of properties changed since the last block
+    core::props::ChangeQueue::current().apply_all();
 
-    int ref_count = 0;
+    std::atomic_int ref_count = 0;
     auto in_buf = enable_input ? core::audio::AudioBufferHandle(in_data, nframes, ref_count) : Application::current().audio_manager->buffer_pool().allocate_clear();
-    // steal the inner midi buffer
-    auto out = Application::current().engine_manager->process(
-      {in_buf, {std::move(midi_bufs.inner())}, nframes});
+    auto& midi_in = collect_midi_events();
+    auto out = Application::current().engine_manager->process({in_buf, midi_in, nframes});
 
     // process_audio_output(out);
 
     LOGW_IF(out.nframes != nframes, "Frames went missing!");
 
-    // Separate channels
-    for (int i = 0; i < nframes; i++) {
-      out_data[i * 2] = out.audio[0][i];
-      out_data[i * 2 + 1] = out.audio[1][i];
+    {
+      TIME_SCOPE("RtAudio::output");
+      // RtAudio wants interleaved channels
+      util::audio::interleave(out_data, out.audio[0].data(), out.audio[1].data(), nframes);
     }
 
     if (midi_out) {
@@ -162,12 +177,10 @@ namespace otto::services {
       }
     }
 
-    // return the midi buffer
-    midi_bufs.inner() = out.midi.move_vector_out();
-
     clock::time_point t1 = clock::now();
 
-    _cpu_time.add(std::chrono::nanoseconds(t1 - t0).count() / (1e9 / float(_samplerate) * nframes));
+    float load = record_block(t1 - t0, nframes);
+    load_governor().report(load, nframes / float(_samplerate));
 
     return 0;
   }
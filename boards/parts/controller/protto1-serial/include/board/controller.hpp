@@ -84,7 +84,6 @@ namespace otto::services {
     void insert_key_or_midi(Command cmd, BytesView args, bool do_send_midi);
 
     util::Serial serial = {"/dev/ttyACM0", 10, 1};
-    util::double_buffered<EventBag, util::clear_inner> events_;
     util::double_buffered<std::vector<std::uint8_t>, util::clear_outer> write_buffer_;
     util::thread read_thread;
     bool send_midi_ = true;
@@ -10,7 +10,6 @@
 namespace otto::services {
   using P1SC = PrOTTO1SerialController;
   using Event = P1SC::Event;
-  using EventBag = P1SC::EventBag;
 
   using byte = std::uint8_t;
 
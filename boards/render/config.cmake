@@ -0,0 +1 @@
+otto_include_board(parts/audio/offline)
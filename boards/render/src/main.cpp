@@ -0,0 +1,256 @@
+#include <csignal>
+#include <cstdlib>
+#include <string>
+
+#include <AudioFile.h>
+#include <fmt/format.h>
+
+#include "core/audio/midi.hpp"
+
+#include "services/audio_manager.hpp"
+#include "services/clock_manager.hpp"
+#include "services/controller.hpp"
+#include "services/engine_manager.hpp"
+#include "services/log_manager.hpp"
+#include "services/preset_manager.hpp"
+#include "services/state_manager.hpp"
+#include "services/ui_manager.hpp"
+
+#include "util/jsonfile.hpp"
+
+#include "board/audio_driver.hpp"
+#include "board/midi_input.hpp"
+
+using namespace otto;
+using namespace otto::services;
+
+int handle_exception(const char* e);
+int handle_exception(std::exception& e);
+int handle_exception();
+
+/// Renders midi through the engines to a wav file, as fast as possible
+///
+/// Usage: `otto [options] <input> <output.wav>`, where input is a standard midi file (`.mid`) or
+/// an event script (see read_event_script)
+struct Options {
+  std::string input;
+  std::string output;
+  /// Read engine settings from this state file. Nothing is ever written back
+  std::string state;
+  /// Select this synth, instead of the one in the state file
+  std::string synth;
+  int samplerate = 48000;
+  int buffer_size = 256;
+  /// Length in seconds. Negative means until the last event, plus `tail`
+  double length = -1;
+  double tail = 2;
+  /// Disable the audio worker pool, and process everything on one thread
+  bool serial = false;
+};
+
+static const char* usage = R"(Usage: otto [options] <input.mid|input.txt> <output.wav>
+
+Options:
+  --state <file>        Load engine settings from a state.json file
+  --synth <name>        Select a synth engine, e.g. Goss
+  --samplerate <hz>     Default 48000
+  --buffer-size <n>     Frames per block. Default 256
+  --length <seconds>    Length of the render. Default is the last event, plus the tail
+  --tail <seconds>      Time to render after the last event. Default 2
+  --serial              Process everything on one thread
+)";
+
+Options parse_options(int argc, char* argv[])
+{
+  Options opts;
+  std::vector<std::string> positional;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    auto value = [&] {
+      if (i + 1 >= argc) throw util::exception("Missing value for {}", arg);
+      return std::string(argv[++i]);
+    };
+    if (arg == "--state") {
+      opts.state = value();
+    } else if (arg == "--synth") {
+      opts.synth = value();
+    } else if (arg == "--samplerate") {
+      opts.samplerate = std::stoi(value());
+    } else if (arg == "--buffer-size") {
+      opts.buffer_size = std::stoi(value());
+    } else if (arg == "--length") {
+      opts.length = std::stod(value());
+    } else if (arg == "--tail") {
+      opts.tail = std::stod(value());
+    } else if (arg == "--serial") {
+      opts.serial = true;
+    } else if (arg == "-h" || arg == "--help") {
+      fmt::print(usage);
+      std::exit(0);
+    } else if (arg.size() > 1 && arg[0] == '-') {
+      // Leave the rest for loguru (-v etc)
+      continue;
+    } else {
+      positional.push_back(arg);
+    }
+  }
+  if (positional.size() != 2) {
+    fmt::print(stderr, usage);
+    std::exit(1);
+  }
+  opts.input = positional[0];
+  opts.output = positional[1];
+  return opts;
+}
+
+/// Loads the engine state from a file, if given, and never saves it
+struct RenderStateManager final : StateManager {
+  RenderStateManager(std::string path) : path(std::move(path))
+  {
+    Application::current().events.post_init.subscribe([this] { load(); });
+  }
+
+  void load() override
+  {
+    if (path.empty()) return;
+    util::JsonFile file{path};
+    file.read();
+    for (const auto& [name, client] : _clients) {
+      try {
+        client.load(file.data()[name]);
+      } catch (std::exception& e) {
+        LOGE("Exception while loading state for {}: {}", name, e.what());
+      }
+    }
+    _loaded = true;
+  }
+
+  void save() override {}
+
+  void attach(std::string name, Loader load, Saver save) override
+  {
+    if (_clients.find(name) != _clients.end()) {
+      throw util::exception("Tried to attach a state client with the same name as another: " +
+                            name);
+    }
+    _clients.insert_or_replace(name, Client{name, std::move(load), std::move(save)});
+  }
+
+  void detach(std::string name) override
+  {
+    _clients.erase_all(name);
+  }
+
+  std::string path;
+};
+
+struct DummyUIManager final : UIManager {
+  DummyUIManager() = default;
+
+  void main_ui_loop() override {}
+};
+
+bool ends_with(const std::string& str, const std::string& suffix)
+{
+  return str.size() >= suffix.size() &&
+         str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+void write_wav(const std::string& path, const OfflineAudioManager::Output& output, int samplerate)
+{
+  AudioFile<float> file;
+  file.setAudioBufferSize(2, output[0].size());
+  for (int ch = 0; ch < 2; ch++) {
+    std::copy(output[ch].begin(), output[ch].end(), file.samples[ch].begin());
+  }
+  file.setSampleRate(samplerate);
+  file.setBitDepth(24);
+  if (!file.save(path)) throw util::exception("Could not write {}", path);
+}
+
+int main(int argc, char* argv[])
+{
+  try {
+    auto opts = parse_options(argc, argv);
+
+    Application app{[&] { return std::make_unique<LogManager>(argc, argv); },
+                    [&] { return std::make_unique<RenderStateManager>(opts.state); },
+                    std::make_unique<PresetManager>,
+                    [&] {
+                      return std::make_unique<OfflineAudioManager>(opts.samplerate,
+                                                                   opts.buffer_size);
+                    },
+                    ClockManager::create_default,
+                    std::make_unique<DummyUIManager>,
+                    Controller::make_dummy,
+                    EngineManager::create_default};
+
+    // Overwrite the logger signal handlers
+    std::signal(SIGABRT, Application::handle_signal);
+    std::signal(SIGTERM, Application::handle_signal);
+    std::signal(SIGINT, Application::handle_signal);
+
+    auto& audio = static_cast<OfflineAudioManager&>(*app.audio_manager);
+
+    auto events = ends_with(opts.input, ".mid") || ends_with(opts.input, ".midi")
+                    ? read_midi_file(opts.input, opts.samplerate)
+                    : read_event_script(opts.input, opts.samplerate);
+
+    if (!opts.synth.empty()) app.engine_manager->select("Synth", opts.synth);
+    if (opts.serial) audio.worker_pool().enabled(false);
+
+    app.engine_manager->start();
+    app.audio_manager->start();
+
+    long last_frame = events.empty() ? 0 : events.back().frame;
+    long nframes = opts.length >= 0 ? long(opts.length * opts.samplerate)
+                                    : last_frame + long(opts.tail * opts.samplerate);
+
+    OfflineAudioManager::Output output;
+    auto stats = audio.render(nframes, events, output);
+    write_wav(opts.output, output, opts.samplerate);
+
+    float budget_us = 1e6f * opts.buffer_size / opts.samplerate;
+    fmt::print("Rendered {:.2f} s of audio in {:.3f} s: {:.1f}x realtime\n",
+               stats.audio_seconds(opts.samplerate), stats.process_seconds,
+               stats.realtime_factor(opts.samplerate));
+    fmt::print("Blocks: {} x {} frames, budget {:.0f} us\n", stats.blocks, opts.buffer_size,
+               budget_us);
+    fmt::print("  mean {:.1f} us, p50 {:.1f} us, p99 {:.1f} us, max {:.1f} us\n",
+               stats.process_seconds * 1e6 / std::max(stats.blocks, 1),
+               stats.block_percentile(50), stats.block_percentile(99),
+               stats.block_percentile(100));
+    fmt::print("CPU time: {:.3f} s\n", stats.cpu_seconds);
+    fmt::print("Wrote {}\n", opts.output);
+
+  } catch (const char* e) {
+    return handle_exception(e);
+  } catch (std::exception& e) {
+    return handle_exception(e);
+  } catch (...) {
+    return handle_exception();
+  }
+
+  LOG_F(INFO, "Exiting");
+  return 0;
+}
+
+int handle_exception(const char* e)
+{
+  LOGE(e);
+  LOGE("Exception thrown, exitting!");
+  return 1;
+}
+
+int handle_exception(std::exception& e)
+{
+  LOGE(e.what());
+  LOGE("Exception thrown, exitting!");
+  return 1;
+}
+
+int handle_exception()
+{
+  LOGE("Unknown exception thrown, exitting!");
+  return 1;
+}
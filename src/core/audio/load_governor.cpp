@@ -0,0 +1,60 @@
+#include "load_governor.hpp"
+
+#include <algorithm>
+
+#include "services/log_manager.hpp"
+
+namespace otto::core::audio {
+
+  void LoadGovernor::report(float load, float seconds) noexcept
+  {
+    _average += (load - _average) * std::min(1.f, seconds / average_time);
+    _hold = std::max(0.f, _hold - seconds);
+
+    int lvl = level();
+    if (_hold == 0 && lvl < max_level && (load > panic_load || _average > shed_load)) {
+      set_level(lvl + 1, std::max(load, _average));
+      _hold = hold_time;
+      _calm = 0;
+      return;
+    }
+
+    if (_average < restore_load) {
+      _calm += seconds;
+    } else {
+      _calm = 0;
+    }
+    if (lvl > 0 && _calm >= restore_time) {
+      set_level(lvl - 1, _average);
+      _calm = 0;
+    }
+  }
+
+  int LoadGovernor::voice_limit(int voice_count) const noexcept
+  {
+    int lvl = level();
+    if (lvl < 2) return voice_count;
+    return std::max(1, voice_count >> (lvl - 1));
+  }
+
+  void LoadGovernor::reset() noexcept
+  {
+    _level = 0;
+    _average = 0;
+    _hold = 0;
+    _calm = 0;
+  }
+
+  void LoadGovernor::set_level(int level, float load) noexcept
+  {
+    if (level > this->level()) {
+      RT_LOGW("CPU load at {}%, shedding work (level {})", int(load * 100), level);
+    } else {
+      RT_LOGI("CPU load down to {}%, restoring work (level {})", int(load * 100), level);
+    }
+    _level.store(level, std::memory_order_relaxed);
+  }
+
+} // namespace otto::core::audio
+
+// kak: other_file=load_governor.hpp
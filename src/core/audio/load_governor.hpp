@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+
+namespace otto::core::audio {
+
+  /// Sheds work when the audio thread gets close to missing its deadline
+  ///
+  /// The audio driver reports the load of every block: the time spent processing it, divided by
+  /// the time it plays for. When the load gets too high, the governor steps up a level, and the
+  /// engines read the level to decide how much work to do:
+  ///
+  ///  - Level 0: everything runs.
+  ///  - Level 1: optional work is skipped, like the shimmer of the Wormhole.
+  ///  - Level 2 and up: as level 1, and the voice managers halve the number of voices they play
+  ///    for every level.
+  ///
+  /// When the load has stayed low for a while, the levels are stepped back down, one at a time.
+  /// A note stolen early is a lot less noticeable than a dropout.
+  ///
+  /// The level is only changed from the audio thread, but can be read from any thread. Changes
+  /// are logged with `RT_LOGI`.
+  struct LoadGovernor {
+    static constexpr int max_level = 4;
+
+    /// A single block using more than this share of its period sheds a level right away
+    static constexpr float panic_load = 0.85f;
+    /// Shed a level when the average load gets above this
+    static constexpr float shed_load = 0.7f;
+    /// Restore a level when the average load has stayed below this for {@ref restore_time}
+    static constexpr float restore_load = 0.45f;
+
+    /// Seconds over which the load is averaged
+    static constexpr float average_time = 0.1f;
+    /// Seconds to wait after shedding before shedding again, so the last step can take effect
+    static constexpr float hold_time = 0.25f;
+    /// Seconds of low load before a level is restored
+    static constexpr float restore_time = 3.f;
+
+    /// Report the load of a block. Call this from the audio thread, after each block
+    ///
+    /// @param load the time spent processing the block, divided by its period
+    /// @param seconds the period of the block
+    void report(float load, float seconds) noexcept;
+
+    /// The current level, from 0 to {@ref max_level}
+    int level() const noexcept
+    {
+      return _level.load(std::memory_order_relaxed);
+    }
+
+    /// Whether optional work should be done
+    bool full_quality() const noexcept
+    {
+      return level() == 0;
+    }
+
+    /// The most voices to play at the current level, out of `voice_count`. At least 1.
+    int voice_limit(int voice_count) const noexcept;
+
+    /// Go back to level 0. Not thread safe, call it while the audio is stopped
+    void reset() noexcept;
+
+  private:
+    void set_level(int level, float load) noexcept;
+
+    std::atomic_int _level = 0;
+    float _average = 0;
+    /// Seconds until the level may be raised again
+    float _hold = 0;
+    /// Seconds the average load has been below {@ref restore_load}
+    float _calm = 0;
+  };
+
+} // namespace otto::core::audio
+
+// kak: other_file=load_governor.cpp
@@ -6,6 +6,7 @@
 
 #include "util/algorithm.hpp"
 #include "util/exception.hpp"
+#include "util/local_vector.hpp"
 #include "util/variant.hpp"
 
 #include "services/log_manager.hpp"
@@ -69,8 +70,9 @@ namespace otto::core::midi {
 
     Type type;
 
-    int channel;
-    int time;
+    int channel = 0;
+    /// Offset in frames from the start of the block this event belongs to
+    int time = 0;
   };
 
   struct NoteEvent : MidiEvent {
@@ -201,6 +203,28 @@ namespace otto::core::midi {
     }
   }
 
+  /// The frame offset of `event` within the current block
+  inline int time_of(const AnyMidiEvent& event) noexcept
+  {
+    return util::match(event, [](const MidiEvent& ev) { return ev.time; });
+  }
+
+  /// Sort a range of events by their frame offset
+  ///
+  /// The sort is stable, so events at the same offset keep their order (a note off followed by a
+  /// note on stays that way). It is an insertion sort, which does not allocate, and is fast for
+  /// the short, mostly sorted ranges found in a block.
+  template<typename Range>
+  void sort_by_time(Range& events) noexcept
+  {
+    auto by_time = [](const AnyMidiEvent& lhs, const AnyMidiEvent& rhs) {
+      return time_of(lhs) < time_of(rhs);
+    };
+    for (auto it = std::begin(events); it != std::end(events); ++it) {
+      std::rotate(std::upper_bound(std::begin(events), it, *it, by_time), it, std::next(it));
+    }
+  }
+
   inline void generateFreqTable(double tuning = 440)
   {
     for (int i = 0; i < 128; i++) {
@@ -218,114 +242,139 @@ namespace otto::core::midi {
     return detail::freq_table[key];
   }
 
-  template<typename T, typename Allocator = std::allocator<T>>
-  struct shared_vector {
-    using value_type = T;
-    using vector_type = std::vector<T, Allocator>;
-    using allocator_type = Allocator;
-    using iterator = typename vector_type::iterator;
-
-    shared_vector() = default;
+  /// Fixed capacity storage for the midi events of one block
+  ///
+  /// Owned by the audio driver, and cleared every block. It never allocates. When it is full, new
+  /// events are dropped (the oldest ones are kept, as they are due first), and counted so the
+  /// driver can report it.
+  struct MidiEventBuffer {
+    /// The maximum number of events in a single block
+    static constexpr std::size_t capacity = 256;
 
-    shared_vector(vector_type&& other) : _data(std::make_shared<vector_type>(std::move(other))) {}
+    using iterator = AnyMidiEvent*;
+    using const_iterator = const AnyMidiEvent*;
 
-    shared_vector(const vector_type& other) : _data(std::make_shared<vector_type>(other)) {}
-
-    shared_vector(const allocator_type& alloc) : _data(std::make_shared<vector_type>(alloc)) {}
-
-    bool empty() const {
-      return _data->empty();
-    }
-
-    auto begin()
-    {
-      return _data->begin();
-    }
-    auto end()
-    {
-      return _data->end();
-    }
-    auto begin() const
+    /// Append an event
+    ///
+    /// @return false if the buffer was full, and the event was dropped
+    bool push_back(const AnyMidiEvent& event) noexcept
     {
-      return _data->begin();
+      if (_events.full()) {
+        _dropped++;
+        return false;
+      }
+      _events.push_back(event);
+      return true;
     }
-    auto end() const
+
+    template<typename... Args>
+    bool emplace_back(Args&&... args) noexcept
     {
-      return _data->end();
+      return push_back(AnyMidiEvent(std::forward<Args>(args)...));
     }
-    auto cbegin() const
+
+    /// Remove all events, and reset the drop count
+    void clear() noexcept
     {
-      return _data->cbegin();
+      _events.clear();
+      _dropped = 0;
     }
-    auto cend() const
+
+    /// The number of events dropped since the last {@ref clear()}
+    int dropped() const noexcept
     {
-      return _data->cend();
+      return _dropped;
     }
 
-    auto&& front()
+    std::size_t size() const noexcept
     {
-      return _data->front();
+      return _events.size();
     }
-    auto&& back()
+
+    bool empty() const noexcept
     {
-      return _data->back();
+      return _events.empty();
     }
-    auto&& front() const
+
+    iterator begin() noexcept
     {
-      return _data->front();
+      return _events.data();
     }
-    auto&& back() const
+
+    iterator end() noexcept
     {
-      return _data->back();
+      return _events.data() + _events.size();
     }
 
-    auto& operator*()
+    const_iterator begin() const noexcept
     {
-      return *_data;
+      return _events.data();
     }
-    auto& operator*() const
+
+    const_iterator end() const noexcept
     {
-      return *_data;
+      return _events.data() + _events.size();
     }
 
-    auto& operator-> ()
+  private:
+    util::local_vector<AnyMidiEvent, capacity> _events;
+    int _dropped = 0;
+  };
+
+  /// Non-owning handle to a {@ref MidiEventBuffer}
+  ///
+  /// This is what is passed around in `ProcessData`. Copies refer to the same buffer, so events
+  /// pushed by one processor are seen by the ones after it.
+  ///
+  /// A default constructed handle refers to no buffer. It is always empty, and drops all events
+  /// pushed to it. Audio-only process data uses this, so constructing it costs nothing.
+  struct MidiBufferRef {
+    using iterator = MidiEventBuffer::iterator;
+
+    MidiBufferRef() noexcept = default;
+    MidiBufferRef(MidiEventBuffer& buffer) noexcept : _buffer(&buffer) {}
+
+    /// Append an event
+    ///
+    /// @return false if the event was dropped
+    bool push_back(const AnyMidiEvent& event) noexcept
     {
-      return &*_data;
+      return _buffer && _buffer->push_back(event);
     }
-    auto& operator-> () const
+
+    template<typename... Args>
+    bool emplace_back(Args&&... args) noexcept
     {
-      return &*_data;
+      return push_back(AnyMidiEvent(std::forward<Args>(args)...));
     }
 
-    auto& operator[](std::size_t i)
+    void clear() noexcept
     {
-      return (_data)[i];
+      if (_buffer) _buffer->clear();
     }
 
-    auto clear()
+    std::size_t size() const noexcept
     {
-      _data->clear();
+      return _buffer ? _buffer->size() : 0;
     }
 
-    auto push_back(const value_type& el)
+    bool empty() const noexcept
     {
-      _data->push_back(el);
+      return size() == 0;
     }
 
-    template<typename... Ref>
-    auto&& emplace_back(Ref&&... args)
+    iterator begin() const noexcept
     {
-      return _data->emplace_back(std::forward<Ref>(args)...);
+      return _buffer ? _buffer->begin() : nullptr;
     }
 
-    auto&& move_vector_out()
+    iterator end() const noexcept
     {
-      return std::move(*_data);
+      return _buffer ? _buffer->end() : nullptr;
     }
 
   private:
-    std::shared_ptr<vector_type> _data = std::make_shared<vector_type>();
+    MidiEventBuffer* _buffer = nullptr;
   };
 
-
 } // namespace otto::core::midi
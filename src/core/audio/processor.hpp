@@ -17,13 +17,18 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <exception>
 #include <functional>
+#include <memory>
+#include <new>
 #include <gsl/span>
 
 #include "core/audio/midi.hpp"
 
 #include "util/audio.hpp"
+#include "util/simd.hpp"
 
 namespace otto::core::audio {
 
@@ -41,13 +46,29 @@ namespace otto::core::audio {
     static constexpr auto value = N;
   };
 
+  struct AudioBufferPool;
+
+  /// Alignment of the buffers from an {@ref AudioBufferPool}, in bytes
+  ///
+  /// A cache line, which covers every SIMD width up to 512 bits. The buffers are also padded to
+  /// a multiple of this, so kernels can process whole vectors past the end of a block.
+  constexpr std::size_t buffer_alignment = 64;
+
   /// A handle to an audio buffer
+  ///
+  /// The reference count is atomic, so handles to the same buffer may be copied and released on
+  /// different threads, like the workers of {@ref WorkerPool}. When the last handle to a buffer
+  /// from an {@ref AudioBufferPool} is released, the buffer goes back to the pool.
   struct AudioBufferHandle {
     using iterator = float*;
     using pointer = float*;
     using const_iterator = const float*;
 
-    AudioBufferHandle(float* data, std::size_t length, int& reference_count) noexcept
+    /// A handle to no buffer
+    AudioBufferHandle() noexcept : _data(nullptr), _length(0), _reference_count(nullptr) {}
+
+    /// A handle to a buffer that is not from a pool, like the buffers of the audio driver
+    AudioBufferHandle(float* data, std::size_t length, std::atomic_int& reference_count) noexcept
       : _data(data), _length(length), _reference_count(&reference_count)
     {
       (*_reference_count)++;
@@ -55,27 +76,36 @@ namespace otto::core::audio {
 
     ~AudioBufferHandle() noexcept
     {
-      if (_reference_count) (*_reference_count)--;
+      unref();
     };
 
     AudioBufferHandle(AudioBufferHandle&& rhs) noexcept
-      : _data(rhs._data), _length(rhs._length), _reference_count(rhs._reference_count)
+      : _data(rhs._data),
+        _length(rhs._length),
+        _reference_count(rhs._reference_count),
+        _pool(rhs._pool)
     {
       rhs._data = nullptr;
       rhs._reference_count = nullptr;
     }
 
     AudioBufferHandle(const AudioBufferHandle& rhs) noexcept
-      : _data(rhs._data), _length(rhs._length), _reference_count(rhs._reference_count)
+      : _data(rhs._data),
+        _length(rhs._length),
+        _reference_count(rhs._reference_count),
+        _pool(rhs._pool)
     {
-      (*_reference_count)++;
+      if (_reference_count) (*_reference_count)++;
     }
 
     AudioBufferHandle& operator=(AudioBufferHandle&& rhs) noexcept
     {
+      if (&rhs == this) return *this;
+      unref();
       _data = rhs._data;
       _length = rhs._length;
       _reference_count = rhs._reference_count;
+      _pool = rhs._pool;
       rhs._data = nullptr;
       rhs._reference_count = nullptr;
       return *this;
@@ -83,10 +113,13 @@ namespace otto::core::audio {
 
     AudioBufferHandle& operator=(const AudioBufferHandle& rhs) noexcept
     {
+      if (&rhs == this) return *this;
+      if (rhs._reference_count) (*rhs._reference_count)++;
+      unref();
       _data = rhs._data;
       _length = rhs._length;
       _reference_count = rhs._reference_count;
-      (*_reference_count)++;
+      _pool = rhs._pool;
       return *this;
     }
 
@@ -134,7 +167,7 @@ namespace otto::core::audio {
 
     void release()
     {
-      (*_reference_count)--;
+      unref();
       _reference_count = nullptr;
       _data = nullptr;
     }
@@ -144,6 +177,13 @@ namespace otto::core::audio {
       std::fill(begin(), end(), 0);
     }
 
+    /// Whether the buffer is from a pool, and starts on a {@ref buffer_alignment} boundary, so it
+    /// can be viewed as an {@ref AlignedBufferView}. Slices and driver buffers usually aren't.
+    bool is_aligned() const noexcept
+    {
+      return _pool != nullptr && reinterpret_cast<std::uintptr_t>(_data) % buffer_alignment == 0;
+    }
+
     /// Get only a slice of the audio.
     ///
     /// \param idx The index to start from
@@ -154,7 +194,8 @@ namespace otto::core::audio {
     AudioBufferHandle slice(int idx, int length = -1)
     {
       length = length < 0 ? _length - idx : length;
-      return {_data + idx, std::size_t(length), *_reference_count};
+      (*_reference_count)++;
+      return {_data + idx, std::size_t(length), *_reference_count, _pool};
     }
 
     float* data()
@@ -168,36 +209,69 @@ namespace otto::core::audio {
     }
 
   private:
+    friend struct AudioBufferPool;
+
+    /// Take over a reference that has already been counted
+    AudioBufferHandle(float* data,
+                      std::size_t length,
+                      std::atomic_int& reference_count,
+                      AudioBufferPool* pool) noexcept
+      : _data(data), _length(length), _reference_count(&reference_count), _pool(pool)
+    {}
+
+    /// Drop this handle's reference, and return the buffer to its pool if it was the last one
+    void unref() noexcept;
+
     float* _data;
     std::size_t _length;
-    int* _reference_count;
+    std::atomic_int* _reference_count;
+    /// The pool the buffer goes back to, or `nullptr`
+    AudioBufferPool* _pool = nullptr;
   };
 
+  /// A fixed set of audio buffers
+  ///
+  /// Every buffer starts on a {@ref buffer_alignment} boundary, and is padded up to the next one.
+  ///
+  /// Free buffers are kept in a lock-free list, so {@ref allocate} is O(1), and may be called from
+  /// several threads at once, like the workers of {@ref WorkerPool}. A buffer is returned to the
+  /// list when its last handle is released.
+  ///
+  /// The number of buffers is fixed while the audio is running. The routing graph works out how
+  /// many it needs when it is compiled, and calls {@ref reserve} before the audio starts. If the
+  /// pool still runs dry, {@ref allocate} hands out a shared overflow buffer, so the audio is
+  /// garbled instead of the process dying, and the error is logged once.
   struct AudioBufferPool {
-    static constexpr int number_of_buffers = 8;
+    /// Enough for a few engines used on their own, outside of a routing graph
+    static constexpr int default_capacity = 8;
+
     AudioBufferPool(std::size_t buffer_size) : buffer_size(buffer_size)
     {
-      // For now this is hardcoded, which is nice, cause we notice if we suddenly are using too many
-      // buffers
-      reserve(number_of_buffers);
+      reallocate();
     }
 
     AudioBufferHandle allocate() noexcept
     {
-      for (std::size_t i = 0; i < reference_counts.size(); i++) {
-        if (reference_counts[i] < 1) {
-          if (i > _max_val) {
-            LOGI("Using {} buffers", i + 1);
-            _max_val = i;
-          }
-          reference_counts[i] = 0;
-          int index = i * buffer_size;
-          return {data.get() + index, buffer_size, reference_counts[i]};
+      std::uint64_t head = _free_head.load(std::memory_order_acquire);
+      while (index_of(head) >= 0) {
+        int i = index_of(head);
+        std::uint64_t next = pack(_next_free[i].load(std::memory_order_relaxed), tag_of(head) + 1);
+        if (_free_head.compare_exchange_weak(head, next, std::memory_order_acq_rel)) {
+          reference_counts[i] = 1;
+          int used = ++_in_use;
+          int peak = _peak.load();
+          while (used > peak && !_peak.compare_exchange_weak(peak, used))
+            ;
+          if (used > peak) RT_LOGI("Using {} audio buffers", used);
+          return {data.get() + i * _stride, buffer_size, reference_counts[i], this};
         }
       }
-      // TODO: handle this reasonably
-      LOGF("No free audio buffers found. This shouldn't happen");
-      std::terminate();
+      if (_overflows++ == 0) {
+        RT_LOGE("All {} audio buffers are in use. Audio will be garbled until some are released",
+                _capacity);
+      }
+      _overflow_refs++;
+      return {data.get() + _capacity * _stride, buffer_size, _overflow_refs, nullptr};
     }
 
     AudioBufferHandle allocate_clear()
@@ -219,42 +293,218 @@ namespace otto::core::audio {
       return util::generate_array<NN>([this](int) { return allocate_clear(); });
     }
 
+    /// Change the size of the buffers.
+    ///
+    /// Not thread safe, and all handles are invalidated. Call it while the audio is stopped.
     void set_buffer_size(std::size_t bs) noexcept
     {
       buffer_size = bs;
-      reserve(number_of_buffers);
+      reallocate();
+    }
+
+    /// Make sure the pool has at least `count` buffers.
+    ///
+    /// Like {@ref set_buffer_size}, only call it while the audio is stopped, and no buffers are in
+    /// use.
+    void reserve(int count) noexcept
+    {
+      if (count <= _capacity) return;
+      _capacity = count;
+      reallocate();
+    }
+
+    /// The number of buffers
+    int capacity() const noexcept
+    {
+      return _capacity;
+    }
+
+    /// The most buffers that have been in use at the same time
+    int peak() const noexcept
+    {
+      return _peak;
+    }
+
+    /// The number of times {@ref allocate} found no free buffer
+    int overflows() const noexcept
+    {
+      return _overflows;
     }
 
   private:
-    void reserve(std::size_t n) noexcept
+    friend struct AudioBufferHandle;
+
+    struct AlignedDelete {
+      void operator()(float* ptr) const noexcept
+      {
+        ::operator delete[](ptr, std::align_val_t{buffer_alignment});
+      }
+    };
+
+    // The head of the free list is an index, and a tag that changes on every update, so a CAS
+    // can't succeed on a head that was popped and pushed back in the meantime (ABA)
+    static constexpr int index_of(std::uint64_t head) noexcept
+    {
+      return static_cast<std::int32_t>(head & 0xFFFFFFFF);
+    }
+    static constexpr std::uint32_t tag_of(std::uint64_t head) noexcept
+    {
+      return head >> 32;
+    }
+    static constexpr std::uint64_t pack(int index, std::uint32_t tag) noexcept
+    {
+      return std::uint64_t{tag} << 32 | static_cast<std::uint32_t>(index);
+    }
+
+    /// Push a buffer whose last handle was released back on the free list
+    void recycle(std::atomic_int& reference_count) noexcept
     {
-      data = std::make_unique<float[]>(n * buffer_size);
-      _avaliable_buffers = n;
-      reference_counts.resize(_avaliable_buffers, 0);
+      int i = &reference_count - reference_counts.get();
+      _in_use--;
+      std::uint64_t head = _free_head.load(std::memory_order_relaxed);
+      do {
+        _next_free[i].store(index_of(head), std::memory_order_relaxed);
+      } while (!_free_head.compare_exchange_weak(head, pack(i, tag_of(head) + 1),
+                                                 std::memory_order_acq_rel));
+    }
+
+    void reallocate() noexcept
+    {
+      constexpr std::size_t floats_per_line = buffer_alignment / sizeof(float);
+      _stride = (buffer_size + floats_per_line - 1) / floats_per_line * floats_per_line;
+      // One more for the overflow buffer
+      std::size_t count = (_capacity + 1) * _stride;
+      data.reset(static_cast<float*>(
+        ::operator new[](count * sizeof(float), std::align_val_t{buffer_alignment})));
+      std::fill(data.get(), data.get() + count, 0.f);
+      reference_counts = std::make_unique<std::atomic_int[]>(_capacity);
+      _next_free = std::make_unique<std::atomic_int[]>(_capacity);
+      for (int i = 0; i < _capacity; i++) _next_free[i] = i + 1 < _capacity ? i + 1 : -1;
+      _free_head = pack(0, 0);
+      _in_use = 0;
     }
 
     std::size_t buffer_size;
-    std::vector<int> reference_counts;
-    std::size_t _avaliable_buffers = 0;
-    std::unique_ptr<float[]> data;
-    std::size_t _max_val = -1;
+    /// The distance between buffers, in floats. The buffer size, padded to the alignment
+    std::size_t _stride = 0;
+    int _capacity = default_capacity;
+    std::unique_ptr<float[], AlignedDelete> data;
+    std::unique_ptr<std::atomic_int[]> reference_counts;
+    /// The free buffer after each free buffer, or -1
+    std::unique_ptr<std::atomic_int[]> _next_free;
+    std::atomic<std::uint64_t> _free_head;
+    std::atomic_int _in_use = 0;
+    std::atomic_int _peak = 0;
+    std::atomic_int _overflows = 0;
+    std::atomic_int _overflow_refs = 0;
+  };
+
+  inline void AudioBufferHandle::unref() noexcept
+  {
+    if (_reference_count == nullptr) return;
+    if (--(*_reference_count) == 0 && _pool != nullptr) _pool->recycle(*_reference_count);
+  }
+
+  /// A view of `Channels` planar audio buffers, with a compile time alignment guarantee
+  ///
+  /// `Alignment` is in bytes. When it is at least the SIMD alignment, the buffers are also padded
+  /// to a whole number of vectors, and {@ref load} and {@ref store} use aligned instructions.
+  /// Kernels can take a view with the alignment they need, and views convert to weaker
+  /// alignments, but not stronger ones.
+  template<int Channels, std::size_t Alignment = buffer_alignment>
+  struct AlignedBufferView {
+    static constexpr int channels = Channels;
+    static constexpr std::size_t alignment = Alignment;
+    /// Whether whole vectors can be loaded and stored with aligned instructions, past `nframes`
+    static constexpr bool simd_aligned = Alignment % util::simd::alignment == 0;
+
+    AlignedBufferView(std::array<float*, Channels> data, int nframes) noexcept
+      : _data(data), _nframes(nframes)
+    {
+      for (float* ptr : _data) {
+        OTTO_ASSERT(reinterpret_cast<std::uintptr_t>(ptr) % Alignment == 0,
+                    "Audio buffer is not aligned to {} bytes", Alignment);
+      }
+    }
+
+    /// View pool buffers. Only the first `nframes` frames are audio
+    AlignedBufferView(const std::array<AudioBufferHandle, Channels>& buffers, int nframes) noexcept
+      : AlignedBufferView(util::generate_array<Channels>([&](int n) { return buffers[n].data(); }),
+                          nframes)
+    {}
+
+    template<std::size_t A, typename = std::enable_if_t<Alignment % A == 0 && A != Alignment>>
+    operator AlignedBufferView<Channels, A>() const noexcept
+    {
+      return {_data, _nframes};
+    }
+
+    float* channel(int ch) const noexcept
+    {
+      return _data[ch];
+    }
+
+    gsl::span<float> operator[](int ch) const noexcept
+    {
+      return {_data[ch], _nframes};
+    }
+
+    int nframes() const noexcept
+    {
+      return _nframes;
+    }
+
+    /// The number of frames kernels may process. For SIMD aligned views, `nframes` rounded up to
+    /// a whole number of vectors. The frames past `nframes` are padding, and hold no audio.
+    int padded_frames() const noexcept
+    {
+      return simd_aligned ? util::simd::padded(_nframes) : _nframes;
+    }
+
+    /// Load a vector from channel `ch`, starting at `frame`, which must be a multiple of the SIMD
+    /// width for aligned views
+    util::simd::float4 load(int ch, int frame) const noexcept
+    {
+      if constexpr (simd_aligned) {
+        return util::simd::float4::load(_data[ch] + frame);
+      } else {
+        return util::simd::float4::loadu(_data[ch] + frame);
+      }
+    }
+
+    void store(int ch, int frame, util::simd::float4 v) const noexcept
+    {
+      if constexpr (simd_aligned) {
+        v.store(_data[ch] + frame);
+      } else {
+        v.storeu(_data[ch] + frame);
+      }
+    }
+
+  private:
+    std::array<float*, Channels> _data;
+    int _nframes;
   };
 
+  /// A view with no alignment guarantee, for buffers from the driver, or slices
+  template<int Channels>
+  using UnalignedBufferView = AlignedBufferView<Channels, alignof(float)>;
+
   /// Non-owning package of data passed to audio processors
   template<int N>
   struct ProcessData {
     static constexpr int channels = N;
 
     std::array<AudioBufferHandle, channels> audio;
-    midi::shared_vector<midi::AnyMidiEvent> midi;
+    midi::MidiBufferRef midi;
     long nframes;
 
     ProcessData(std::array<AudioBufferHandle, channels> audio,
-                midi::shared_vector<midi::AnyMidiEvent> midi,
+                midi::MidiBufferRef midi,
                 long nframes) noexcept;
 
     ProcessData(std::array<AudioBufferHandle, channels> audio,
-                midi::shared_vector<midi::AnyMidiEvent> midi) noexcept;
+                midi::MidiBufferRef midi) noexcept;
 
     ProcessData(std::array<AudioBufferHandle, channels> audio) noexcept;
 
@@ -277,6 +527,10 @@ namespace otto::core::audio {
     ProcessData slice(int idx, int length = -1);
 
     std::array<float*, channels> raw_audio_buffers();
+
+    /// View the audio as aligned buffers. The buffers must be from a pool, see
+    /// {@ref AudioBufferHandle::is_aligned}
+    AlignedBufferView<N> view() const noexcept;
   };
 
   using TestType = std::vector<struct Tag>;
@@ -286,10 +540,10 @@ namespace otto::core::audio {
   struct ProcessData<0> {
     static constexpr int channels = 0;
 
-    midi::shared_vector<midi::AnyMidiEvent> midi;
+    midi::MidiBufferRef midi;
     long nframes;
 
-    ProcessData(midi::shared_vector<midi::AnyMidiEvent> midi, long nframes) noexcept;
+    ProcessData(midi::MidiBufferRef midi, long nframes) noexcept;
 
     template<std::size_t NN>
     ProcessData<NN> redirect(const std::array<AudioBufferHandle, NN>& buf);
@@ -304,23 +558,23 @@ namespace otto::core::audio {
     static constexpr int channels = 1;
 
     AudioBufferHandle audio;
-    midi::shared_vector<midi::AnyMidiEvent> midi;
+    midi::MidiBufferRef midi;
     long nframes;
 
     ProcessData(std::array<AudioBufferHandle, channels> audio,
-                midi::shared_vector<midi::AnyMidiEvent> midi,
+                midi::MidiBufferRef midi,
                 long nframes) noexcept;
 
     ProcessData(std::array<AudioBufferHandle, channels> audio,
-                midi::shared_vector<midi::AnyMidiEvent> midi) noexcept;
+                midi::MidiBufferRef midi) noexcept;
 
     ProcessData(std::array<AudioBufferHandle, channels> audio) noexcept;
 
     ProcessData(AudioBufferHandle audio,
-                midi::shared_vector<midi::AnyMidiEvent> midi,
+                midi::MidiBufferRef midi,
                 long nframes) noexcept;
 
-    ProcessData(AudioBufferHandle audio, midi::shared_vector<midi::AnyMidiEvent> midi) noexcept;
+    ProcessData(AudioBufferHandle audio, midi::MidiBufferRef midi) noexcept;
 
     ProcessData(AudioBufferHandle audio) noexcept;
 
@@ -341,6 +595,10 @@ namespace otto::core::audio {
     ProcessData slice(int idx, int length = -1);
 
     std::array<float*, channels> raw_audio_buffers();
+
+    /// View the audio as an aligned buffer. It must be from a pool, see
+    /// {@ref AudioBufferHandle::is_aligned}
+    AlignedBufferView<1> view() const noexcept;
   };
 
 
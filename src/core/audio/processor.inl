@@ -5,14 +5,14 @@ namespace otto::core::audio {
 
   template<int N>
   ProcessData<N>::ProcessData(std::array<AudioBufferHandle, channels> audio,
-                              midi::shared_vector<midi::AnyMidiEvent> midi,
+                              midi::MidiBufferRef midi,
                               long nframes) noexcept
     : audio(audio), midi(midi), nframes(nframes)
   {}
 
   template<int N>
   ProcessData<N>::ProcessData(std::array<AudioBufferHandle, channels> audio,
-                              midi::shared_vector<midi::AnyMidiEvent> midi) noexcept
+                              midi::MidiBufferRef midi) noexcept
     : audio(audio), midi(midi), nframes(audio[0].size())
   {}
 
@@ -69,10 +69,15 @@ namespace otto::core::audio {
     return {util::generate_array<channels>([&](int n) { return audio[n].data(); })};
   }
 
+  template<int N>
+  AlignedBufferView<N> ProcessData<N>::view() const noexcept
+  {
+    return {audio, int(nframes)};
+  }
+
   // ProcessData<0> //
 
-  inline ProcessData<0>::ProcessData(midi::shared_vector<midi::AnyMidiEvent> midi,
-                                     long nframes) noexcept
+  inline ProcessData<0>::ProcessData(midi::MidiBufferRef midi, long nframes) noexcept
     : midi(midi), nframes(nframes)
   {}
 
@@ -95,13 +100,12 @@ namespace otto::core::audio {
   // ProcessDaata<1> //
 
   inline ProcessData<1>::ProcessData(AudioBufferHandle audio,
-                                     midi::shared_vector<midi::AnyMidiEvent> midi,
+                                     midi::MidiBufferRef midi,
                                      long nframes) noexcept
     : audio(audio), midi(midi), nframes(nframes)
   {}
 
-  inline ProcessData<1>::ProcessData(AudioBufferHandle audio,
-                                     midi::shared_vector<midi::AnyMidiEvent> midi) noexcept
+  inline ProcessData<1>::ProcessData(AudioBufferHandle audio, midi::MidiBufferRef midi) noexcept
     : audio(audio), midi(midi), nframes(audio.size())
   {}
 
@@ -110,13 +114,13 @@ namespace otto::core::audio {
   {}
 
   inline ProcessData<1>::ProcessData(std::array<AudioBufferHandle, channels> audio,
-                                     midi::shared_vector<midi::AnyMidiEvent> midi,
+                                     midi::MidiBufferRef midi,
                                      long nframes) noexcept
     : audio(audio[0]), midi(midi), nframes(nframes)
   {}
 
   inline ProcessData<1>::ProcessData(std::array<AudioBufferHandle, channels> audio,
-                                     midi::shared_vector<midi::AnyMidiEvent> midi) noexcept
+                                     midi::MidiBufferRef midi) noexcept
     : audio(audio[0]), midi(midi), nframes(audio[0].size())
   {}
 
@@ -167,6 +171,11 @@ namespace otto::core::audio {
     return {audio.data()};
   }
 
+  inline AlignedBufferView<1> ProcessData<1>::view() const noexcept
+  {
+    return {std::array<float*, 1>{audio.data()}, int(nframes)};
+  }
+
 } // namespace otto::core::audio
 
 // kak: other_file=processor.hpp
@@ -0,0 +1,152 @@
+#include "worker_pool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <string>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "core/props/change_queue.hpp"
+#include "services/log_manager.hpp"
+
+namespace otto::core::audio {
+
+  namespace {
+    /// Set while running a task, so jobs posted from inside a task run serially
+    thread_local bool in_task = false;
+
+    /// Below the audio thread, which is usually at 80-90, but above everything else
+    constexpr int worker_priority = 70;
+
+    /// How long a worker keeps spinning after the last job, before it goes to sleep. A few
+    /// periods, so it stays awake while the audio is running
+    constexpr auto spin_time = std::chrono::milliseconds(20);
+
+    inline void cpu_relax() noexcept
+    {
+#if defined(__x86_64__) || defined(__i386__)
+      __builtin_ia32_pause();
+#elif defined(__arm__) || defined(__aarch64__)
+      asm volatile("yield");
+#endif
+    }
+
+    void make_realtime(int core) noexcept
+    {
+#ifdef __linux__
+      sched_param param = {};
+      param.sched_priority = worker_priority;
+      if (int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param); err != 0) {
+        LOGW("Could not set realtime priority for audio worker: {}", std::strerror(err));
+      }
+      cpu_set_t cpus;
+      CPU_ZERO(&cpus);
+      CPU_SET(core, &cpus);
+      if (int err = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus); err != 0) {
+        LOGW("Could not pin audio worker to core {}: {}", core, std::strerror(err));
+      }
+#endif
+    }
+  } // namespace
+
+  int WorkerPool::default_thread_count() noexcept
+  {
+    return std::max(0, int(std::thread::hardware_concurrency()) - 2);
+  }
+
+  WorkerPool::WorkerPool(int threads)
+  {
+    _threads.reserve(threads);
+    for (int i = 0; i < threads; i++) {
+      _threads.emplace_back([this, i] { worker_main(i); });
+    }
+  }
+
+  WorkerPool::~WorkerPool() noexcept
+  {
+    _should_run = false;
+    _wake.notify_all();
+    for (auto& thread : _threads) thread.join();
+  }
+
+  void WorkerPool::run(int count, TaskFn fn, void* ctx) noexcept
+  {
+    if (count <= 1 || in_task || !enabled()) {
+      for (int i = 0; i < count; i++) fn(ctx, i);
+      return;
+    }
+
+    _fn = fn;
+    _ctx = ctx;
+    _count = count;
+    _next = 0;
+    _done = 0;
+    _open = true;
+    _generation++;
+    if (_sleeping > 0) _wake.notify_all();
+
+    in_task = true;
+    work();
+    in_task = false;
+
+    // Wait for the tasks the workers took
+    while (_done.load(std::memory_order_acquire) < count) cpu_relax();
+    // And for late workers to see that the job is over, before the next one overwrites it
+    _open = false;
+    while (_active > 0) cpu_relax();
+  }
+
+  void WorkerPool::work() noexcept
+  {
+    for (int i = _next++; i < _count; i = _next++) {
+      _fn(_ctx, i);
+      _done.fetch_add(1, std::memory_order_release);
+    }
+  }
+
+  void WorkerPool::worker_main(int index) noexcept
+  {
+    using clock = std::chrono::steady_clock;
+
+    loguru::set_thread_name(("audio worker " + std::to_string(index)).c_str());
+    int cores = std::thread::hardware_concurrency();
+    // Keep the workers off core 0, which is left to the audio thread and the rest of the system
+    if (cores > 1) make_realtime(1 + index % (cores - 1));
+    // Properties set while processing should not be deferred to the next block
+    props::ChangeQueue::mark_audio_thread();
+    in_task = true;
+
+    unsigned seen = _generation;
+    auto last_job = clock::now();
+    while (_should_run) {
+      if (unsigned gen = _generation.load(std::memory_order_acquire); gen != seen) {
+        seen = gen;
+        _active++;
+        if (_open) work();
+        _active--;
+        last_job = clock::now();
+        continue;
+      }
+
+      if (clock::now() - last_job < spin_time) {
+        for (int i = 0; i < 64; i++) cpu_relax();
+        continue;
+      }
+
+      // Idle. The audio thread wakes us when it posts a job. The timeout covers a wakeup that
+      // is missed because the job was posted right before we started waiting.
+      std::unique_lock lock{_mutex};
+      _sleeping++;
+      _wake.wait_for(lock, std::chrono::milliseconds(1),
+                     [&] { return !_should_run || _generation != seen; });
+      _sleeping--;
+    }
+  }
+
+} // namespace otto::core::audio
+
+// kak: other_file=worker_pool.hpp
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace otto::core::audio {
+
+  /// Realtime worker threads, that help the audio thread process independent work in parallel
+  ///
+  /// Work is handed out as a range of task indices. The calling thread always takes part, and
+  /// grabs tasks like any worker, so a job finishes even if no worker wakes up in time. Workers
+  /// spin while the audio is running, and only sleep when no job has been posted for a while.
+  ///
+  /// On Linux, workers run with `SCHED_FIFO` and are pinned to their own core, when the process
+  /// has permission to do so.
+  ///
+  /// Jobs are only run in parallel from one thread at a time, the audio thread. A job posted from
+  /// inside a task, or while the pool is disabled, runs serially on the calling thread.
+  struct WorkerPool {
+    /// Leaves a core for the audio thread, and one for the UI
+    static int default_thread_count() noexcept;
+
+    /// @param threads the number of workers, not counting the calling thread
+    WorkerPool(int threads = default_thread_count());
+    ~WorkerPool() noexcept;
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    /// The number of workers, not counting the calling thread
+    int size() const noexcept
+    {
+      return static_cast<int>(_threads.size());
+    }
+
+    /// Whether jobs are run in parallel. If not, everything runs serially on the calling thread.
+    bool enabled() const noexcept
+    {
+      return _enabled.load(std::memory_order_relaxed) && size() > 0;
+    }
+
+    void enabled(bool enable) noexcept
+    {
+      _enabled = enable;
+    }
+
+    /// Call `f(i)` for all `i` in `[0, count)`, in parallel, and return when all calls are done.
+    ///
+    /// `f` must be safe to call concurrently with different indices.
+    template<typename F>
+    void parallel_for(int count, F&& f)
+    {
+      auto& fn = f;
+      run(count, [](void* ctx, int i) { (*static_cast<decltype(&fn)>(ctx))(i); }, &fn);
+    }
+
+    /// Call each of `fs` in parallel, and return when all of them are done
+    template<typename... Fs>
+    void parallel_invoke(Fs&&... fs)
+    {
+      parallel_for(sizeof...(Fs), [&](int i) {
+        int n = 0;
+        ((i == n++ ? (void) fs() : void()), ...);
+      });
+    }
+
+  private:
+    using TaskFn = void (*)(void* ctx, int index);
+
+    void run(int count, TaskFn fn, void* ctx) noexcept;
+    /// Take and run tasks from the current job until there are none left
+    void work() noexcept;
+    void worker_main(int index) noexcept;
+
+    std::atomic_bool _enabled = true;
+    std::atomic_bool _should_run = true;
+
+    // The current job. Only written while `_open` is false, and no worker is `_active`
+    TaskFn _fn = nullptr;
+    void* _ctx = nullptr;
+    int _count = 0;
+    alignas(64) std::atomic_int _next = 0;
+    alignas(64) std::atomic_int _done = 0;
+
+    /// Incremented when a job is posted
+    alignas(64) std::atomic_uint _generation = 0;
+    std::atomic_bool _open = false;
+    /// Workers currently looking at the job
+    std::atomic_int _active = 0;
+
+    std::atomic_int _sleeping = 0;
+    std::mutex _mutex;
+    std::condition_variable _wake;
+
+    std::vector<std::thread> _threads;
+  };
+
+} // namespace otto::core::audio
+
+// kak: other_file=worker_pool.cpp
@@ -0,0 +1,356 @@
+#include "routing_graph.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+#include "services/audio_manager.hpp"
+#include "services/log_manager.hpp"
+#include "util/algorithm.hpp"
+#include "util/audio.hpp"
+#include "util/exception.hpp"
+
+namespace otto::core::engine {
+
+  struct RoutingGraph::Plan {
+    struct Input {
+      /// Index of the step whose output is read
+      int source;
+      Gain* gain;
+      Gain* pan;
+    };
+
+    struct Step {
+      int in_channels = 0;
+      int out_channels = 0;
+      Process process;
+      util::LatencyHistogram* times = nullptr;
+      std::vector<Input> inputs;
+      /// The input bus is the output of the first input, and the others are added to it
+      bool alias_first = false;
+      Bus out;
+    };
+
+    std::vector<Step> steps;
+    /// The step of the external input, or -1 if nothing reads it
+    int input = -1;
+    int output = -1;
+    /// Steps that can run at the same time
+    std::vector<std::vector<int>> levels;
+    /// Steps whose output is not read after each level
+    std::vector<std::vector<int>> releases;
+    /// The most pool buffers held at once
+    int buffers = 0;
+  };
+
+  namespace {
+    /// Mix one channel into another, with a gain ramp. With `overwrite`, the result is written
+    /// instead of added, so the bus doesn't need clearing
+    void mix_channel(float* dst,
+                     const float* src,
+                     int nframes,
+                     float from,
+                     float to,
+                     bool overwrite) noexcept
+    {
+      if (overwrite) {
+        util::audio::gain_ramp(dst, src, nframes, from, to);
+      } else {
+        util::audio::mix_add_ramp(dst, src, nframes, from, to);
+      }
+    }
+
+    /// Mix `src` into `dst`, applying gain and pan
+    ///
+    /// The gain and pan are ramped linearly over the block, from where their smoothers are to
+    /// where they will be at the end of it.
+    ///
+    /// @return false if the edge is muted, and nothing was written
+    bool mix(const RoutingGraph::Bus& src,
+             RoutingGraph::Bus& dst,
+             RoutingGraph::Gain* gain_prop,
+             RoutingGraph::Gain* pan_prop,
+             bool overwrite,
+             int nframes) noexcept
+    {
+      auto* gain = gain_prop ? &gain_prop->smoother() : nullptr;
+      auto* pan = pan_prop ? &pan_prop->smoother() : nullptr;
+      if (gain && !gain->is_smoothing() && gain->value() == 0) return false;
+      float g0 = gain ? gain->value() : 1.f;
+      float g1 = gain ? gain->skip(nframes) : 1.f;
+      float p0 = pan ? pan->value() : 0.f;
+      float p1 = pan ? pan->skip(nframes) : 0.f;
+
+      const float* s0 = src.audio[0].data();
+      if (dst.channels == 1) {
+        // Stereo is averaged down to mono
+        if (src.channels == 1) {
+          mix_channel(dst.audio[0].data(), s0, nframes, g0, g1, overwrite);
+        } else {
+          mix_channel(dst.audio[0].data(), s0, nframes, g0 * 0.5f, g1 * 0.5f, overwrite);
+          mix_channel(dst.audio[0].data(), src.audio[1].data(), nframes, g0 * 0.5f, g1 * 0.5f,
+                      false);
+        }
+      } else {
+        const float* s1 = src.channels == 2 ? src.audio[1].data() : s0;
+        mix_channel(dst.audio[0].data(), s0, nframes, g0 * (1 - p0), g1 * (1 - p1), overwrite);
+        mix_channel(dst.audio[1].data(), s1, nframes, g0 * (1 + p0), g1 * (1 + p1), overwrite);
+      }
+      return true;
+    }
+  } // namespace
+
+  void RoutingGraph::Bus::release() noexcept
+  {
+    for (auto& buf : audio) buf.release();
+  }
+
+  RoutingGraph::RoutingGraph() = default;
+  RoutingGraph::~RoutingGraph() = default;
+
+  RoutingGraph::NodeId RoutingGraph::add_input(std::string name)
+  {
+    if (_input >= 0) throw util::exception("The routing graph already has an input");
+    _input = add_node(std::move(name), 0, 1, nullptr);
+    return _input;
+  }
+
+  RoutingGraph::NodeId RoutingGraph::add_node(std::string name,
+                                              int in_channels,
+                                              int out_channels,
+                                              Process process,
+                                              int scratch_buffers)
+  {
+    if (in_channels < 0 || in_channels > 2 || out_channels < 1 || out_channels > 2) {
+      throw util::exception("Invalid channel count for routing node {}", name);
+    }
+    auto& n = _nodes.emplace_back();
+    n.name = std::move(name);
+    n.in_channels = in_channels;
+    n.out_channels = out_channels;
+    n.process = std::move(process);
+    n.scratch_buffers = scratch_buffers;
+    return static_cast<NodeId>(_nodes.size() - 1);
+  }
+
+  void RoutingGraph::connect(NodeId from, NodeId to, Gain* gain, Gain* pan)
+  {
+    check_node(from);
+    check_node(to);
+    if (_nodes[to].in_channels == 0) {
+      throw util::exception("Routing node {} has no input", _nodes[to].name);
+    }
+    _edges.push_back({from, to, gain, pan});
+  }
+
+  void RoutingGraph::disconnect(NodeId from, NodeId to)
+  {
+    util::erase_if(_edges, [&](const Edge& e) { return e.from == from && e.to == to; });
+  }
+
+  void RoutingGraph::output(NodeId node)
+  {
+    check_node(node);
+    if (_nodes[node].out_channels != 2) {
+      throw util::exception("The routing graph output {} must be stereo", _nodes[node].name);
+    }
+    _output = node;
+  }
+
+  void RoutingGraph::check_node(NodeId node) const
+  {
+    if (node < 0 || node >= static_cast<NodeId>(_nodes.size())) {
+      throw util::exception("Invalid routing node {}", node);
+    }
+  }
+
+  void RoutingGraph::compile()
+  {
+    if (_output < 0) throw util::exception("The routing graph has no output");
+    const int nnodes = _nodes.size();
+
+    // Only the nodes the output depends on are processed. Their levels are found depth first,
+    // which also catches cycles.
+    constexpr int unvisited = -2;
+    constexpr int visiting = -3;
+    std::vector<int> level(nnodes, unvisited);
+    std::function<int(NodeId)> visit = [&](NodeId node) -> int {
+      if (level[node] == visiting) {
+        throw util::exception("The routing graph has a cycle through {}", _nodes[node].name);
+      }
+      if (level[node] != unvisited) return level[node];
+      level[node] = visiting;
+      int lvl = 0;
+      for (auto& e : _edges) {
+        if (e.to == node) lvl = std::max(lvl, visit(e.from) + 1);
+      }
+      // The input is there before anything is processed
+      if (node == _input) lvl = -1;
+      return level[node] = lvl;
+    };
+    visit(_output);
+
+    auto plan = std::make_unique<Plan>();
+    std::vector<int> step_of(nnodes, -1);
+    std::vector<NodeId> node_of_step;
+    for (NodeId node = 0; node < nnodes; node++) {
+      if (level[node] == unvisited) continue;
+      step_of[node] = plan->steps.size();
+      node_of_step.push_back(node);
+      auto& step = plan->steps.emplace_back();
+      step.in_channels = _nodes[node].in_channels;
+      step.out_channels = _nodes[node].out_channels;
+      step.out.channels = step.out_channels;
+      step.process = _nodes[node].process;
+      step.times = _nodes[node].times.get();
+    }
+    plan->input = _input >= 0 ? step_of[_input] : -1;
+    plan->output = step_of[_output];
+
+    int nlevels = 0;
+    for (NodeId node = 0; node < nnodes; node++) nlevels = std::max(nlevels, level[node] + 1);
+    plan->levels.resize(nlevels);
+    plan->releases.resize(nlevels);
+
+    std::vector<int> readers(nnodes, 0);
+    std::vector<int> last_read(nnodes, -1);
+    for (auto& e : _edges) {
+      if (level[e.to] < 0) continue;
+      readers[e.from]++;
+      last_read[e.from] = std::max(last_read[e.from], level[e.to]);
+      plan->steps[step_of[e.to]].inputs.push_back({step_of[e.from], e.gain, e.pan});
+    }
+
+    for (NodeId node = 0; node < nnodes; node++) {
+      if (level[node] < 0) continue;
+      auto& step = plan->steps[step_of[node]];
+      plan->levels[level[node]].push_back(step_of[node]);
+      // Use an input as the bus if it would just be copied there, and nobody else needs it
+      auto alias = util::find_if(step.inputs, [&](auto& in) {
+        return in.gain == nullptr && in.pan == nullptr && in.source != plan->input &&
+               plan->steps[in.source].out_channels == step.in_channels &&
+               readers[node_of_step[in.source]] == 1;
+      });
+      if (alias != step.inputs.end()) {
+        std::rotate(step.inputs.begin(), alias, alias + 1);
+        step.alias_first = true;
+      }
+    }
+
+    for (NodeId node = 0; node < nnodes; node++) {
+      if (step_of[node] < 0 || node == _output || last_read[node] < 0) continue;
+      plan->releases[last_read[node]].push_back(step_of[node]);
+    }
+
+    // Count the pool buffers held during each level. The external input is held by the driver
+    // for the whole block. A node holds its input bus, unless it is aliased, and its scratch
+    // buffers while it runs. Its output is held until it is released after the last level that
+    // reads it, or to the end for the output of the graph.
+    std::vector<int> held(std::max(nlevels, 1), 1);
+    for (NodeId node = 0; node < nnodes; node++) {
+      if (level[node] < 0) continue;
+      auto& step = plan->steps[step_of[node]];
+      held[level[node]] += (step.alias_first ? 0 : step.in_channels) + _nodes[node].scratch_buffers;
+      int until = node == _output ? nlevels - 1 : last_read[node];
+      for (int l = level[node]; l <= until; l++) held[l] += step.out_channels;
+    }
+    plan->buffers = *std::max_element(held.begin(), held.end());
+
+    auto& audio_manager = *Application::current().audio_manager;
+    auto& pool = audio_manager.buffer_pool();
+    if (plan->buffers > pool.capacity()) {
+      if (audio_manager.running()) {
+        LOGW("The routing graph needs {} audio buffers, but the pool only has {}", plan->buffers,
+             pool.capacity());
+      } else {
+        pool.reserve(plan->buffers);
+      }
+    }
+
+    _active_plan.store(plan.get(), std::memory_order_release);
+    // Wait until the audio thread is done with the old plan
+    audio_manager.wait_one();
+    _plan = std::move(plan);
+  }
+
+  int RoutingGraph::peak_buffers() const noexcept
+  {
+    return _plan ? _plan->buffers : 0;
+  }
+
+  int RoutingGraph::node_count() const noexcept
+  {
+    return _nodes.size();
+  }
+
+  const std::string& RoutingGraph::node_name(NodeId node) const
+  {
+    check_node(node);
+    return _nodes[node].name;
+  }
+
+  const util::LatencyHistogram& RoutingGraph::node_times(NodeId node) const
+  {
+    check_node(node);
+    return *_nodes[node].times;
+  }
+
+  audio::ProcessData<2> RoutingGraph::process(audio::ProcessData<1> external_in) noexcept
+  {
+    auto& audio_manager = *Application::current().audio_manager;
+    auto& pool = audio_manager.buffer_pool();
+    Plan* plan = _active_plan.load(std::memory_order_acquire);
+    if (plan == nullptr) {
+      return external_in.redirect(pool.allocate_multi_clear<2>());
+    }
+
+    if (plan->input >= 0) plan->steps[plan->input].out.audio[0] = external_in.audio;
+    auto data = external_in.midi_only();
+    const int nframes = external_in.nframes;
+
+    auto run_step = [&](Plan::Step& step) {
+      auto t0 = std::chrono::steady_clock::now();
+      Bus in;
+      in.channels = step.in_channels;
+      std::size_t first = 0;
+      if (step.alias_first) {
+        in.audio = plan->steps[step.inputs[0].source].out.audio;
+        first = 1;
+      } else {
+        for (int ch = 0; ch < in.channels; ch++) in.audio[ch] = pool.allocate();
+      }
+      // The first edge that isn't muted overwrites the bus, so it never has to be cleared
+      bool written = step.alias_first;
+      for (std::size_t i = first; i < step.inputs.size(); i++) {
+        auto& input = step.inputs[i];
+        auto& src = plan->steps[input.source].out;
+        if (mix(src, in, input.gain, input.pan, !written, nframes)) written = true;
+      }
+      if (!written) {
+        for (int ch = 0; ch < in.channels; ch++) in.audio[ch].clear();
+      }
+      step.process(in, step.out, data);
+      in.release();
+      auto t1 = std::chrono::steady_clock::now();
+      step.times->record(std::chrono::duration<float, std::micro>(t1 - t0).count());
+    };
+
+    for (std::size_t l = 0; l < plan->levels.size(); l++) {
+      auto& steps = plan->levels[l];
+      if (steps.size() == 1) {
+        run_step(plan->steps[steps[0]]);
+      } else {
+        audio_manager.worker_pool().parallel_for(
+          steps.size(), [&](int i) { run_step(plan->steps[steps[i]]); });
+      }
+      for (int s : plan->releases[l]) plan->steps[s].out.release();
+    }
+
+    auto& out = plan->steps[plan->output].out;
+    auto res = external_in.redirect(out.audio);
+    out.release();
+    return res;
+  }
+
+} // namespace otto::core::engine
+
+// kak: other_file=routing_graph.hpp
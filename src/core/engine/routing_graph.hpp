@@ -0,0 +1,146 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "core/audio/processor.hpp"
+#include "core/props/props.hpp"
+#include "util/histogram.hpp"
+
+namespace otto::core::engine {
+
+  /// The audio routing between engines
+  ///
+  /// Nodes are engines, or anything else that processes audio. Edges route the output of one
+  /// node to the input of another, with an optional gain and pan. When a node has several
+  /// inputs, they are summed.
+  ///
+  /// The graph is edited from the UI/main thread, and {@ref compile}d into a flat execution plan:
+  /// the nodes that contribute to the output, in topological order, grouped into levels of
+  /// nodes that don't depend on each other. The plan is swapped in atomically, and the audio
+  /// thread only ever reads the current plan.
+  ///
+  /// Nodes in the same level are run in parallel on the audio worker pool. A node's input bus is
+  /// mixed by its own task, right before it is processed. When the first edge into a node is
+  /// at unity gain from a node nobody else reads, the input bus is that node's output, so
+  /// nothing is copied, and the other edges are added to it in place. Edges with a gain of 0 are
+  /// skipped.
+  ///
+  /// Compiling also works out how long each bus lives, from the level that writes it to the
+  /// last level that reads it, and from that the most pool buffers the plan holds at once. The
+  /// {@ref audio::AudioBufferPool} is sized for it, so processing never runs out of buffers.
+  struct RoutingGraph {
+    using NodeId = int;
+    /// Gains are properties, so they can be edited, and are smoothed on the audio thread
+    using Gain = props::Property<float, props::smoothed>;
+
+    /// The audio in or out of a node. Mono buses only use the first channel.
+    struct Bus {
+      int channels = 0;
+      std::array<audio::AudioBufferHandle, 2> audio;
+
+      void release() noexcept;
+    };
+
+    /// Process a node: read the mixed input bus, and set the output bus.
+    ///
+    /// `data` has the midi and the number of frames. A node may process its input in place, and
+    /// return it as the output.
+    using Process = std::function<void(Bus& in, Bus& out, audio::ProcessData<0> data)>;
+
+    RoutingGraph();
+    ~RoutingGraph();
+
+    /// Add the external input. Its output is the audio passed to {@ref process}.
+    NodeId add_input(std::string name);
+
+    /// Add a node
+    ///
+    /// @param in_channels 0, 1 or 2. Nodes without inputs, like synths, get an empty bus
+    /// @param out_channels 1 or 2
+    /// @param scratch_buffers the buffers the node takes from the pool while it runs, besides the
+    /// ones it outputs
+    NodeId add_node(std::string name,
+                    int in_channels,
+                    int out_channels,
+                    Process process,
+                    int scratch_buffers = 0);
+
+    /// Route the output of `from` to the input of `to`
+    ///
+    /// @param gain scales the signal. `nullptr` for unity gain.
+    /// @param pan pans or balances the signal into a stereo input, in `[-1, 1]`. With `nullptr`,
+    /// both channels get the full signal.
+    void connect(NodeId from, NodeId to, Gain* gain = nullptr, Gain* pan = nullptr);
+
+    /// Remove all edges from `from` to `to`
+    void disconnect(NodeId from, NodeId to);
+
+    /// Set the node whose output is the output of the graph. It must be stereo.
+    void output(NodeId node);
+
+    /// Compile the graph, and swap in the new plan.
+    ///
+    /// Call this after editing the graph, from any thread but the audio thread. Waits for the
+    /// current process call to finish before the old plan is freed.
+    ///
+    /// The buffer pool can only grow before the audio is started. A plan that needs more buffers
+    /// later is still used, but a warning is logged.
+    ///
+    /// @throws util::exception if the graph has a cycle, or no output
+    void compile();
+
+    /// Run the current plan. Call this from the audio thread.
+    ///
+    /// If nothing has been compiled yet, the output is silent.
+    audio::ProcessData<2> process(audio::ProcessData<1> external_in) noexcept;
+
+    /// The most pool buffers the current plan holds at once, including the external input
+    int peak_buffers() const noexcept;
+
+    int node_count() const noexcept;
+    const std::string& node_name(NodeId node) const;
+
+    /// The time each process call of `node` has taken, in microseconds, including mixing its
+    /// input bus
+    const util::LatencyHistogram& node_times(NodeId node) const;
+
+  private:
+    struct Node {
+      std::string name;
+      int in_channels = 0;
+      int out_channels = 0;
+      Process process;
+      int scratch_buffers = 0;
+      /// On the heap, so nodes can be moved, and plans can point to it
+      std::unique_ptr<util::LatencyHistogram> times = std::make_unique<util::LatencyHistogram>();
+    };
+
+    struct Edge {
+      NodeId from;
+      NodeId to;
+      Gain* gain;
+      Gain* pan;
+    };
+
+    struct Plan;
+
+    void check_node(NodeId node) const;
+
+    std::vector<Node> _nodes;
+    std::vector<Edge> _edges;
+    NodeId _input = -1;
+    NodeId _output = -1;
+
+    std::unique_ptr<Plan> _plan;
+    /// The plan the audio thread uses
+    std::atomic<Plan*> _active_plan = nullptr;
+  };
+
+} // namespace otto::core::engine
+
+// kak: other_file=routing_graph.cpp
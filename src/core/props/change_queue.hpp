@@ -0,0 +1,128 @@
+#pragma once
+
+#include <atomic>
+#include <type_traits>
+
+#include "util/lockfree_queue.hpp"
+
+namespace otto::core::props {
+
+  /// Moves `on_change` signals from other threads to the audio thread
+  ///
+  /// When a property with the `signal` mixin is set from any thread but the audio thread, its
+  /// handlers are not run right away. The new value is stored, the property is queued here, and
+  /// the audio thread runs the handlers with the latest value at the start of the next block.
+  /// Handlers can then safely modify DSP state, and a burst of encoder changes to one property
+  /// only runs them once per block.
+  ///
+  /// Only properties of arithmetic or enum type are deferred. Others, like strings, are still
+  /// emitted on the calling thread. Their handlers can prepare new state there, and hand it to
+  /// the audio thread with {@ref defer()}.
+  ///
+  /// Deferral is off until the audio thread first calls {@ref apply_all()}, so properties behave
+  /// synchronously in tests and on boards without audio.
+  ///
+  /// @note A queued property must not be destroyed before its change has been applied.
+  struct ChangeQueue {
+    struct Change {
+      void* target;
+      void (*apply)(void* target);
+    };
+
+    static ChangeQueue& current() noexcept
+    {
+      static ChangeQueue instance;
+      return instance;
+    }
+
+    /// Whether changes made on the calling thread should be queued
+    bool should_defer() const noexcept
+    {
+      return _enabled.load(std::memory_order_acquire) && !_is_audio_thread;
+    }
+
+    /// Queue a change. May be called from any thread.
+    ///
+    /// @return false if the queue was full. The caller should apply the change itself.
+    bool push(Change change) noexcept
+    {
+      return _queue.try_push(change);
+    }
+
+    /// Run `change` on the audio thread, like a deferred property change
+    ///
+    /// For state that is prepared on another thread, and only handed over on the audio thread,
+    /// like a table loaded from disk. Runs it right away when changes are not deferred, or the
+    /// queue is full.
+    void defer(Change change) noexcept
+    {
+      if (!should_defer() || !push(change)) change.apply(change.target);
+    }
+
+    /// Apply all queued changes.
+    ///
+    /// Call this from the audio thread, at the start of each block. Marks the calling thread as
+    /// the audio thread, and enables deferral, unless {@ref disable()} has been called.
+    void apply_all() noexcept
+    {
+      _is_audio_thread = true;
+      if (!_stopped.load(std::memory_order_relaxed)) _enabled = true;
+      _queue.consume([](Change&& c) { c.apply(c.target); });
+    }
+
+    /// Mark the calling thread as part of the audio thread, like the audio workers, so changes
+    /// made on it are not deferred.
+    static void mark_audio_thread() noexcept
+    {
+      _is_audio_thread = true;
+    }
+
+    /// Stop deferring changes, and apply the queued ones on the calling thread.
+    ///
+    /// Only call this when the audio thread has stopped calling {@ref apply_all()}.
+    void disable() noexcept
+    {
+      _stopped = true;
+      _enabled = false;
+      _queue.consume([](Change&& c) { c.apply(c.target); });
+    }
+
+  private:
+    ChangeQueue() = default;
+
+    util::mpsc_queue<Change, 1024> _queue;
+    std::atomic_bool _enabled = false;
+    std::atomic_bool _stopped = false;
+    static inline thread_local bool _is_audio_thread = false;
+  };
+
+  namespace detail {
+    template<typename T>
+    struct is_lock_free_atomic : std::bool_constant<std::atomic<T>::is_always_lock_free> {};
+
+    template<typename T>
+    constexpr bool is_deferrable_v =
+      std::conjunction_v<std::disjunction<std::is_arithmetic<T>, std::is_enum<T>>,
+                         is_lock_free_atomic<T>>;
+
+    /// The latest value of a property with a queued change
+    ///
+    /// Copies start out with nothing queued.
+    template<typename T, typename Enable = void>
+    struct PendingChange {};
+
+    template<typename T>
+    struct PendingChange<T, std::enable_if_t<is_deferrable_v<T>>> {
+      PendingChange() = default;
+      PendingChange(const PendingChange&) noexcept {}
+      PendingChange& operator=(const PendingChange&) noexcept
+      {
+        return *this;
+      }
+
+      std::atomic<T> value = T{};
+      std::atomic_bool queued = false;
+    };
+  } // namespace detail
+
+} // namespace otto::core::props
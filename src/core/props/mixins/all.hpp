@@ -5,3 +5,4 @@
 #include "wrap.hpp"
 #include "pow2.hpp"
 #include "signal.hpp"
+#include "smoothed.hpp"
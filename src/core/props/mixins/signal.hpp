@@ -4,6 +4,7 @@
 
 #include "util/utility.hpp"
 
+#include "../change_queue.hpp"
 #include "../internal/mixin_macros.hpp"
 #include "../internal/property.hpp"
 
@@ -19,8 +20,20 @@ namespace otto::core::props {
   OTTO_PROPS_MIXIN_LEAF (signal) {
     OTTO_PROPS_MIXIN_DECLS(signal);
 
+    /// Emit `on_change`, or queue it for the audio thread. See {@ref ChangeQueue}
     void on_hook(hook<common::hooks::after_set, HookOrder::After> & hook)
     {
+      if constexpr (detail::is_deferrable_v<value_type>) {
+        auto& queue = ChangeQueue::current();
+        if (queue.should_defer()) {
+          _pending.value = as_prop().get();
+          // Already queued, and the audio thread will read the new value
+          if (_pending.queued.exchange(true)) return;
+          if (queue.push({this, &apply_pending})) return;
+          // The queue is full. Emit here, rather than losing the change
+          _pending.queued = false;
+        }
+      }
       _on_change.emit(as_prop().get());
     }
 
@@ -30,7 +43,15 @@ namespace otto::core::props {
     }
 
   private:
+    static void apply_pending(void* target)
+    {
+      auto& self = *static_cast<self_type*>(target);
+      self._pending.queued = false;
+      self._on_change.emit(self._pending.value);
+    }
+
     util::Signal<value_type> _on_change;
+    detail::PendingChange<value_type> _pending;
   };
 
 } // namespace otto::core::props
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+
+#include <Gamma/Domain.h>
+
+#include "util/dsp/smoothed_value.hpp"
+
+#include "../internal/mixin_macros.hpp"
+#include "../internal/property.hpp"
+
+namespace otto::core::props {
+
+  OTTO_PROPS_MIXIN(smoothed);
+
+  /// Shorthand for smoothed::init
+  inline auto smoothing(float seconds,
+                        util::dsp::SmoothingMode mode = util::dsp::SmoothingMode::linear)
+  {
+    return smoothed::init(seconds, mode);
+  }
+
+  /// Ramp the value used by the audio thread towards the value of the property
+  ///
+  /// The property can be set from any thread. The audio thread reads the latest value once per
+  /// block through {@ref smoother()}.
+  OTTO_PROPS_MIXIN_LEAF (smoothed) {
+    OTTO_PROPS_MIXIN_DECLS(smoothed);
+
+    static_assert(std::is_floating_point_v<value_type>,
+                  "The 'smoothed' mixin requires a floating point type");
+
+    leaf() = default;
+    leaf(const leaf& rhs) noexcept
+      : _seconds(rhs._seconds), _mode(rhs._mode), _target(rhs._target.load())
+    {}
+
+    leaf& operator=(const leaf& rhs) noexcept
+    {
+      _seconds = rhs._seconds;
+      _mode = rhs._mode;
+      _target = rhs._target.load();
+      return *this;
+    }
+
+    /// @param seconds the length of a ramp, in seconds
+    void init(float seconds = 0.02f,
+              util::dsp::SmoothingMode mode = util::dsp::SmoothingMode::linear)
+    {
+      _seconds = seconds;
+      _mode = mode;
+    }
+
+    void on_hook(hook<common::hooks::after_set, HookOrder::After> & hook)
+    {
+      _target.store(as_prop().get(), std::memory_order_relaxed);
+    }
+
+    /// The smoothed value, with its target updated to the latest value of the property.
+    ///
+    /// Only use this from the audio thread, and call it once per block.
+    util::dsp::SmoothedValue& smoother() noexcept
+    {
+      int frames = _seconds * gam::Domain::master().spu();
+      if (!_started) {
+        _smoother = util::dsp::SmoothedValue(as_prop().get(), frames, _mode);
+        _target.store(as_prop().get(), std::memory_order_relaxed);
+        _started = true;
+      } else if (frames != _smoother.ramp_length()) {
+        _smoother.set_ramp_length(frames);
+      }
+      _smoother.set_target(_target.load(std::memory_order_relaxed));
+      return _smoother;
+    }
+
+  private:
+    float _seconds = 0.02f;
+    util::dsp::SmoothingMode _mode = util::dsp::SmoothingMode::linear;
+    std::atomic<value_type> _target = value_type{0};
+    bool _started = false;
+    util::dsp::SmoothedValue _smoother;
+  };
+
+} // namespace otto::core::props
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "util/simd.hpp"
+#include "services/log_manager.hpp"
+
+namespace otto::core::voices {
+
+  /// Structure-of-arrays state shared by all voices of an engine
+  ///
+  /// An opt-in alternative to keeping all per-voice state inside the voice objects. Each voice
+  /// claims a lane, and the state of all lanes is kept in contiguous, aligned float arrays, so
+  /// the preprocessor can advance `util::simd::width` voices per instruction.
+  ///
+  /// Results are rendered frame-major into a block buffer, where the value of lane `l` at frame
+  /// `f` is at `block[f * lane_stride + l]`. Voices read their column in their own `process`.
+  ///
+  /// Lanes that are not in use keep running, which is cheaper than masking them out. Lanes past
+  /// the highest one in use can be left out of {@ref process} altogether.
+  ///
+  /// @tparam N the number of voices
+  template<int N>
+  struct VoiceLanes {
+    /// Number of lanes, padded to the SIMD width
+    static constexpr int lane_stride = util::simd::padded(N);
+
+    using LaneArray = std::array<float, lane_stride>;
+
+    /// Claim the next lane. Meant to be called from voice constructors
+    int claim() noexcept
+    {
+      OTTO_ASSERT(claimed_ < N);
+      return claimed_++;
+    }
+
+    /// Make sure the block buffers can hold `nframes` frames
+    ///
+    /// Call this outside the audio thread with the expected buffer size. {@ref process} never
+    /// allocates.
+    void reserve(int nframes)
+    {
+      if (nframes <= capacity_) return;
+      capacity_ = nframes;
+      phase_block_.resize(std::size_t(capacity_ * lane_stride) + util::simd::width);
+      level_block_.resize(std::size_t(capacity_ * lane_stride) + util::simd::width);
+    }
+
+    /// Set the phase increment of all lanes to `frequency * scale`
+    ///
+    /// @param scale usually `1 / samplerate`, possibly multiplied by a shared modulation
+    /// @param nlanes only the first `nlanes` lanes, rounded up to the SIMD width, are updated
+    void update_increments(float scale, int nlanes = N) noexcept
+    {
+      using util::simd::float4;
+      float4 s = scale;
+      const int end = util::simd::padded(nlanes);
+      for (int l = 0; l < end; l += util::simd::width) {
+        (float4::load(&frequency[l]) * s).store(&increment[l]);
+      }
+    }
+
+    /// The most frames {@ref process} can advance at once
+    int capacity() const noexcept
+    {
+      return capacity_;
+    }
+
+    /// Advance the phase and level lanes `nframes` frames
+    ///
+    /// At most {@ref capacity()} frames fit in the block buffers, so split longer blocks. The
+    /// preprocessor can report the capacity through `PreBase::max_frames`, and the voice manager
+    /// does the splitting. Frames past the capacity are not advanced.
+    ///
+    /// @param nlanes only the first `nlanes` lanes, rounded up to the SIMD width, are advanced.
+    /// The block values of the others are left as they were.
+    void process(int nframes, int nlanes = N) noexcept
+    {
+      if (nframes > capacity_) {
+        RT_LOGW("VoiceLanes: block of {} frames exceeds reserved {}", nframes, capacity_);
+        nframes = capacity_;
+      }
+      nframes_ = nframes;
+      float* phases = aligned(phase_block_);
+      float* levels = aligned(level_block_);
+      const int end = util::simd::padded(nlanes);
+      for (int l = 0; l < end; l += util::simd::width) {
+        using util::simd::float4;
+        float4 ph = float4::load(&phase[l]);
+        float4 inc = float4::load(&increment[l]);
+        float4 lvl = float4::load(&level[l]);
+        float4 dec = float4::load(&decay[l]);
+        for (int f = 0; f < nframes; f++) {
+          ph = wrap(ph + inc);
+          lvl = lvl * dec;
+          ph.store(&phases[f * lane_stride + l]);
+          lvl.store(&levels[f * lane_stride + l]);
+        }
+        ph.store(&phase[l]);
+        lvl.store(&level[l]);
+      }
+    }
+
+    /// Phase of `lane` at `frame` in the last processed block, in `[0, 1)`
+    float phase_at(int lane, int frame) const noexcept
+    {
+      return aligned(phase_block_)[frame * lane_stride + lane];
+    }
+
+    /// Level of `lane` at `frame` in the last processed block
+    float level_at(int lane, int frame) const noexcept
+    {
+      return aligned(level_block_)[frame * lane_stride + lane];
+    }
+
+    /// Number of frames in the last processed block
+    int nframes() const noexcept
+    {
+      return nframes_;
+    }
+
+    /// Frequency per lane, in Hz. Written by the voices
+    alignas(util::simd::alignment) LaneArray frequency = {};
+    /// Current phase per lane, in `[0, 1)`
+    alignas(util::simd::alignment) LaneArray phase = {};
+    /// Phase increment per frame per lane, i.e. `frequency / samplerate`
+    alignas(util::simd::alignment) LaneArray increment = {};
+    /// Current level per lane
+    alignas(util::simd::alignment) LaneArray level = {};
+    /// Multiplicative decay of the level per frame
+    alignas(util::simd::alignment) LaneArray decay = {};
+
+  private:
+    /// std::vector only guarantees alignment of `alignof(float)`, so the block buffers are
+    /// overallocated by one SIMD width, and offset here.
+    template<typename Vec>
+    static auto aligned(Vec& v) noexcept -> decltype(v.data())
+    {
+      auto addr = reinterpret_cast<std::uintptr_t>(v.data());
+      auto offset = (util::simd::alignment - addr % util::simd::alignment) % util::simd::alignment;
+      return v.data() + offset / sizeof(float);
+    }
+
+    std::vector<float> phase_block_;
+    std::vector<float> level_block_;
+    int capacity_ = 0;
+    int nframes_ = 0;
+    int claimed_ = 0;
+  };
+
+} // namespace otto::core::voices
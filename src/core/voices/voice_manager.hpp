@@ -1,10 +1,12 @@
 #pragma once
 
 #include <deque>
+#include <limits>
 #include <type_traits>
 #include <vector>
 
 #include <Gamma/Envelope.h>
+#include <gsl/span>
 #include "util/dsp/SegExpBypass.hpp"
 
 #include "core/props/props.hpp"
@@ -14,10 +16,17 @@
 
 #include "util/crtp.hpp"
 #include "util/algorithm.hpp"
+#include "util/dsp/halfband.hpp"
 
 namespace otto::core::voices {
 
-  template<typename PostT, int NumberOfVoices>
+  /// The most voices a synth can be set to play
+  ///
+  /// Synths allocate this many voices up front, and the voice settings choose how many of them
+  /// are used.
+  constexpr int max_voices = 16;
+
+  template<typename PostT, int MaxVoices>
   struct VoiceManager;
 
   template<typename DerivedT, typename PropsT>
@@ -26,11 +35,38 @@ namespace otto::core::voices {
 
     void operator()() noexcept {};
 
+    /// Process a block of `nframes` frames
+    ///
+    /// Called once per block, before the voices are processed. The default implementation calls
+    /// {@ref operator()} once per frame, so existing preprocessors keep working unchanged.
+    void process(int nframes) noexcept;
+
+    /// The most frames {@ref process} can handle at once
+    ///
+    /// Preprocessors that render into buffers reserved up front hide this with their capacity,
+    /// and the voice manager splits longer blocks instead of letting them allocate.
+    int max_frames() const noexcept
+    {
+      return std::numeric_limits<int>::max();
+    }
+
     /// Constructor
     PreBase(Props& p) noexcept;
 
     /// The engine properties.
     Props& props;
+
+    /// One past the highest voice that is currently active
+    ///
+    /// Set by the voice manager before each call to {@ref process}, so preprocessors that keep
+    /// state for every voice can skip the ones that are silent.
+    int voices_in_use = 0;
+
+    /// How many frames the voices render per output frame
+    ///
+    /// Set through {@ref VoiceManager::oversampling}. Pre- and postprocessing run at the output
+    /// rate.
+    int oversampling = 1;
   };
 
   /// Base class for voices
@@ -48,7 +84,9 @@ namespace otto::core::voices {
   /// aftertouch, along with some other relevant data, including the current envelope value.
   ///
   /// It also lets the user implement handlers for note_on and note_off events, along with
-  /// the main process call {@ref operator()}, which processes one sample at a time.
+  /// the main process call. This is either {@ref operator()}, which processes one sample at a
+  /// time, or {@ref process}, which renders a whole block. Voices that only implement
+  /// `float operator()()` get the default `process`, which adapts it to the block interface.
   ///
   /// @tparam Derived the derived voice type
   /// @tparam Props the Props type of the engine.
@@ -93,9 +131,44 @@ namespace otto::core::voices {
     /// The current envelope value
     float envelope() noexcept;
 
+    /// Is this voice producing sound?
+    ///
+    /// True while the envelope is running, or while the voice reports a tail. Inactive voices are
+    /// skipped entirely by the voice manager.
+    bool is_active() noexcept;
+
+    /// Implement to keep the voice rendering after its envelope has finished
+    ///
+    /// Only useful for voices that implement their own `process`, as the default one scales
+    /// the output by the envelope.
+    bool has_tail() noexcept;
+
+    /// Render a block of audio, adding it to `output`
+    ///
+    /// The default implementation calls `float operator()()` once per frame, applying glide,
+    /// pitch bend and the envelope. Voices can hide this with their own
+    /// `void process(gsl::span<float>)` to render whole blocks at once.
+    ///
+    /// Note that the output is summed into, not overwritten, as all voices share the buffer.
+    void process(gsl::span<float> output) noexcept;
+
+    /// Whether the voice manager may render several voices of this type at once
+    ///
+    /// Set this to false in the derived voice if `process` writes to state shared between
+    /// voices, other than the voice's own slots in the preprocessor.
+    static constexpr bool render_in_parallel = true;
+
     Pre& pre;
     Props& props;
 
+  protected:
+    /// Advance glide, pitch bend and the envelope over a block
+    ///
+    /// For voices implementing their own `process`. Writes one envelope value per frame to
+    /// `envelope`, and updates {@ref frequency()} for every frame, leaving it at the value of
+    /// the last one.
+    void render_envelope(gsl::span<float> envelope) noexcept;
+
   private:
     template<typename T, int N>
     friend struct VoiceManager;
@@ -103,10 +176,14 @@ namespace otto::core::voices {
     void trigger(int midi_note, float velocity) noexcept;
     void release() noexcept;
 
+    /// Advance glide and envelope one frame, and render one sample of the derived voice
+    float render_frame() noexcept;
+
     float frequency_ = 440.f;
     float velocity_ = 1.f;
     float aftertouch_ = 0.f;
     int midi_note_ = 0;
+    float pitch_bend_ = 1.f;
 
     gam::ADSR<> env_;
     gam::SegExp<> glide_{0.f};
@@ -118,15 +195,16 @@ namespace otto::core::voices {
     static_assert(std::is_base_of_v<VoiceBase<Voice, typename Voice::VoiceBase::Pre>, Voice>,
                   "PostBase<Derived, Voice>: Voice must inherit from VoiceBase<Voice, Pre>");
 
-    static_assert(util::is_invocable_r_v<float, Voice>,
-                  "Voice must have a `float operator()()` defined");
-
-
     using Pre = typename Voice::VoiceBase::Pre;
     using Props = typename Voice::VoiceBase::Props;
 
     float operator()(float f) noexcept { return f; }
 
+    /// Process a block of summed voice output in place
+    ///
+    /// The default implementation calls `float operator()(float)` once per frame.
+    void process(gsl::span<float> buffer) noexcept;
+
     /// Constructor
     PostBase(Pre& p) noexcept;
 
@@ -166,8 +244,10 @@ namespace otto::core::voices {
                                                              props::step_size(0.01)};
       props::Property<int, props::no_signal> octave = {0, props::limits(-2, 7)};
       props::Property<int, props::no_signal> transpose = {0, props::limits(-12, 12)};
+      /// The number of voices played in poly mode. The upper limit is set by the voice manager
+      props::Property<int> voice_count = {6, props::limits(1, max_voices)};
 
-      DECL_REFLECTION(SettingsProps, play_mode, portamento, octave, transpose);
+      DECL_REFLECTION(SettingsProps, play_mode, portamento, octave, transpose, voice_count);
     };
 
     std::unique_ptr<ui::Screen> make_envelope_screen(EnvelopeProps& props);
@@ -182,8 +262,16 @@ namespace otto::core::voices {
     using EnvelopeProps = details::EnvelopeProps;
     using SettingsProps = details::SettingsProps;
 
+    /// Buffers a voice manager takes from the pool while rendering, besides its output
+    static constexpr int scratch_buffers = 3;
+
     virtual ~IVoiceManager() = default;
+    /// The number of voices that are played, as set in the voice settings
     virtual int voice_count() noexcept = 0;
+    /// Set the number of voices that are played, up to {@ref max_voice_count}
+    virtual void voice_count(int count) noexcept = 0;
+    /// The number of voices that are allocated
+    virtual int max_voice_count() noexcept = 0;
 
     virtual ui::Screen& envelope_screen() noexcept = 0;
     virtual ui::Screen& settings_screen() noexcept = 0;
@@ -191,26 +279,42 @@ namespace otto::core::voices {
 
   // -- VOICE MANAGER -- //
 
-  template<typename PostT, int NumberOfVoices>
+  /// Manages the voices of a synth
+  ///
+  /// All `MaxVoices` voices are allocated up front. The `voice_count` setting picks how many of
+  /// them are handed out to notes, so polyphony can be changed at runtime without allocating.
+  /// Voices that are not in use are never active, so they cost nothing to render.
+  ///
+  /// When the CPU load is high, the {@ref audio::LoadGovernor} lowers the number of notes that
+  /// may play at once, and notes are stolen earlier.
+  template<typename PostT, int MaxVoices>
   struct VoiceManager : IVoiceManager {
     /// PostProcessor
     using Post = PostT;
 
     static_assert(std::is_base_of_v<PostBase<Post, typename Post::PostBase::Voice>, Post>,
                   "PostBase<Derived, Post>: Post must inherit from PostBase<Post, Voice>");
-    static_assert(util::is_invocable_r_v<float, Post, float>,
-                  "Post must have a `float operator()(float)` defined");
 
     using Voice = typename Post::PostBase::Voice;
     using Props = typename Post::PostBase::Props;
     using Pre = typename Post::PostBase::Pre;
 
-    /// The number of voices
-    static constexpr int voice_count_v = NumberOfVoices;
+    /// The number of voices that are allocated
+    static constexpr int max_voices_v = MaxVoices;
 
     int voice_count() noexcept override
     {
-      return NumberOfVoices;
+      return settings_props.voice_count;
+    }
+
+    void voice_count(int count) noexcept override
+    {
+      settings_props.voice_count = count;
+    }
+
+    int max_voice_count() noexcept override
+    {
+      return MaxVoices;
     }
 
     // Assert requirements met
@@ -223,11 +327,14 @@ namespace otto::core::voices {
 
     /// Constructor
     VoiceManager(Props& props) noexcept;
+    ~VoiceManager() noexcept;
 
     ui::Screen& envelope_screen() noexcept override;
     ui::Screen& settings_screen() noexcept override;
 
-    /// Process audio, applying Preprocessing, each voice and then postprocessing
+    /// Process one frame, applying Preprocessing, each voice and then postprocessing
+    ///
+    /// Prefer {@ref process}, which renders the voices a block at a time.
     float operator()() noexcept;
 
     Voice& handle_midi_on(const midi::NoteOnEvent&) noexcept;
@@ -236,16 +343,71 @@ namespace otto::core::voices {
     void handle_control_change(const midi::ControlChangeEvent&) noexcept;
 
     /// Process audio, applying Preprocessing, each voice and then postprocessing
+    ///
+    /// The block is split at the frame offset of each midi event, so events take effect on the
+    /// exact frame they were scheduled for.
     audio::ProcessData<1> process(audio::ProcessData<1> data) noexcept;
 
-    /// Return list of voices
-    std::array<Voice, voice_count_v>& voices();
+    /// The highest factor the voices can be oversampled by
+    static constexpr int max_oversampling = 4;
+
+    /// Render the voices at 1, 2 or 4 times the sample rate, to keep them from aliasing
+    ///
+    /// The voices are summed at the higher rate, and decimated once, before postprocessing. Only
+    /// for voices that implement their own `process`: they get `oversampling` times as many
+    /// frames, and have to run their oscillators and envelopes accordingly.
+    ///
+    /// The first call allocates the buffers for {@ref max_oversampling}, so make it from the
+    /// engine constructor. They are reallocated when the audio driver changes the buffer size.
+    void oversampling(int factor) noexcept;
+
+    int oversampling() const noexcept
+    {
+      return pre.oversampling;
+    }
+
+    /// Return list of all allocated voices, including the ones that are not in use
+    std::array<Voice, max_voices_v>& voices();
 
     DECL_REFLECTION(VoiceManager,
                     ("envelope", &VoiceManager::envelope_props),
                     ("voice_settings", &VoiceManager::settings_props));
 
   private:
+    /// Render `output.size()` frames: preprocessing, then each voice, then postprocessing
+    ///
+    /// With enough active voices, they are split between the audio worker threads. Each task
+    /// renders its voices into its own buffer, and the buffers are summed before postprocessing.
+    /// When oversampling, the voices render into {@ref oversampled_} instead, and the sum is
+    /// decimated into `output`.
+    void render(gsl::span<float> output) noexcept;
+
+    /// The part of {@ref oversampled_} for render task `task`, `nframes` long
+    ///
+    /// `nframes` must fit in the reserved buffers. {@ref render} splits longer segments.
+    gsl::span<float> oversampled_buffer(int task, int nframes) noexcept;
+
+    /// Allocate {@ref oversampled_} for blocks of `buffer_size` at {@ref max_oversampling}
+    ///
+    /// Not realtime safe. Called from {@ref oversampling}, and on
+    /// `AudioManager::Events::buffer_size_change`, while the audio thread is not running.
+    void reserve_oversampled(int buffer_size);
+
+    /// Fewer active voices than this per task are not worth the synchronization
+    static constexpr int min_voices_per_task = 2;
+    /// Short segments, between midi events, are always rendered on the audio thread
+    static constexpr int min_parallel_frames = 32;
+    /// Each task after the first uses a buffer from the pool
+    static constexpr int max_voice_tasks = scratch_buffers + 1;
+
+    /// Release all voices, and hand out the ones the play mode and voice count allow
+    void reset_voices() noexcept;
+
+    /// Release the voices of the oldest notes, until at most `limit` notes have a voice
+    ///
+    /// The notes stay held, and get a voice back when another note is released.
+    void shed_voices(int limit) noexcept;
+
     Voice& get_voice(int key) noexcept;
     Voice* stop_voice(int key) noexcept;
 
@@ -263,17 +425,24 @@ namespace otto::core::voices {
       }
     };
 
-    float pitch_bend_ = 1;
-
     props::Property<bool> sustain_ = {false};
 
     std::deque<Voice*> free_voices;
     std::vector<NoteVoicePair> note_stack;
+    /// The most notes that may have a voice, as set by the load governor
+    int voice_limit_ = max_voices_v;
+
+    /// Voice output at the oversampled rate, `max_voice_tasks` buffers of `oversampled_frames_`
+    std::vector<float> oversampled_;
+    int oversampled_frames_ = 0;
+    util::dsp::Decimator decimator_;
+    /// Subscription to `AudioManager::Events::buffer_size_change`
+    int buffer_size_subscription_ = -1;
 
     Props& props;
     Pre pre = {props};
-    std::array<Voice, voice_count_v> voices_ =
-      util::generate_array<voice_count_v>([this](auto) { return Voice{pre}; });
+    std::array<Voice, max_voices_v> voices_ =
+      util::generate_array<max_voices_v>([this](auto) { return Voice{pre}; });
     Post post = {pre};
 
     EnvelopeProps envelope_props;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "services/audio_manager.hpp"
+#include "util/timer.hpp"
 #include "voice_manager.hpp"
 
 namespace otto::core::voices {
@@ -11,6 +12,14 @@ namespace otto::core::voices {
   PreBase<D, P>::PreBase(Props& props) noexcept : props(props)
   {}
 
+  template<typename D, typename P>
+  void PreBase<D, P>::process(int nframes) noexcept
+  {
+    for (int i = 0; i < nframes; i++) {
+      derived()();
+    }
+  }
+
   // VOICE BASE //
 
   template<typename D, typename P>
@@ -64,6 +73,45 @@ namespace otto::core::voices {
     return env_.value();
   }
 
+  template<typename D, typename P>
+  bool VoiceBase<D, P>::is_active() noexcept
+  {
+    return !env_.done() || derived().has_tail();
+  }
+
+  template<typename D, typename P>
+  bool VoiceBase<D, P>::has_tail() noexcept
+  {
+    return false;
+  }
+
+  template<typename D, typename P>
+  void VoiceBase<D, P>::process(gsl::span<float> output) noexcept
+  {
+    static_assert(util::is_invocable_r_v<float, D>,
+                  "Voice must define either `float operator()()` or "
+                  "`void process(gsl::span<float>)`");
+    for (auto& frm : output) {
+      frm += render_frame();
+    }
+  }
+
+  template<typename D, typename P>
+  void VoiceBase<D, P>::render_envelope(gsl::span<float> envelope) noexcept
+  {
+    for (auto& env : envelope) {
+      frequency(glide_() * pitch_bend_);
+      env = env_();
+    }
+  }
+
+  template<typename D, typename P>
+  float VoiceBase<D, P>::render_frame() noexcept
+  {
+    frequency(glide_() * pitch_bend_);
+    return env_() * derived()();
+  }
+
   template<typename D, typename P>
   void VoiceBase<D, P>::trigger(int midi_note, float velocity) noexcept
   {
@@ -91,12 +139,23 @@ namespace otto::core::voices {
   PostBase<D, V>::PostBase(Pre& pre) noexcept : pre(pre), props(pre.props)
   {}
 
+  template<typename D, typename V>
+  void PostBase<D, V>::process(gsl::span<float> buffer) noexcept
+  {
+    static_assert(util::is_invocable_r_v<float, D, float>,
+                  "Post must define either `float operator()(float)` or "
+                  "`void process(gsl::span<float>)`");
+    for (auto& frm : buffer) {
+      frm = derived()(frm);
+    }
+  }
+
   // VOICE MANAGER //
 
   template<typename V, int N>
   VoiceManager<V, N>::VoiceManager(Props& props) noexcept : props(props)
   {
-    for (int i = 0; i < voice_count_v; ++i) {
+    for (int i = 0; i < max_voices_v; ++i) {
       auto& voice = voices_[i];
       envelope_props.attack.on_change().connect(
         [&voice](float attack) { voice.env_.attack(8 * attack * attack + 0.02); });
@@ -112,22 +171,13 @@ namespace otto::core::voices {
         }).call_now(settings_props.portamento);
     }
 
-    settings_props.play_mode.on_change()
-      .connect([this](PlayMode mode) {
-        util::for_each(voices_, &Voice::release);
-        note_stack.clear();
-        free_voices.clear();
-
-        switch (mode) {
-        case PlayMode::unison:
-          // TODO: Can not be implemented this way
-          [[fallthrough]];
-        case PlayMode::mono: free_voices.push_back(&voices_[0]); break;
-        case PlayMode::poly:
-          for (auto& voice : voices_) free_voices.push_back(&voice);
-        }
-      })
-      .call_now(settings_props.play_mode);
+    auto& count_limits = settings_props.voice_count.as<props::has_limits>();
+    count_limits.max = max_voices_v;
+    settings_props.voice_count = std::min(settings_props.voice_count.get(), max_voices_v);
+
+    settings_props.play_mode.on_change().connect([this](PlayMode) { reset_voices(); });
+    settings_props.voice_count.on_change().connect([this](int) { reset_voices(); });
+    reset_voices();
 
     sustain_.on_change().connect([this](bool val) {
       if (!val) {
@@ -140,6 +190,18 @@ namespace otto::core::voices {
         }
       }
     });
+
+    buffer_size_subscription_ =
+      Application::current().audio_manager->events.buffer_size_change.subscribe([this](int bs) {
+        if (!oversampled_.empty()) reserve_oversampled(bs);
+      });
+  }
+
+  template<typename V, int N>
+  VoiceManager<V, N>::~VoiceManager() noexcept
+  {
+    Application::current().audio_manager->events.buffer_size_change.unsubscribe(
+      buffer_size_subscription_);
   }
 
   template<typename V, int N>
@@ -160,15 +222,103 @@ namespace otto::core::voices {
     pre();
     float voice_sum = 0.f;
     for (auto& voice : voices_) {
-      ///Change frequency if applicable
-      //voice.frequency(midi::note_freq(voice.midi_note_) * pitch_bend_);
-      voice.frequency(voice.glide_() * pitch_bend_);
-      ///Get next sample
-      voice_sum += voice.env_() * voice();
+      if (!voice.is_active()) continue;
+      voice_sum += voice.render_frame();
     }
     return post(voice_sum);
   }
 
+  template<typename V, int N>
+  void VoiceManager<V, N>::render(gsl::span<float> output) noexcept
+  {
+    // Only if the driver hands us a longer block than it announced
+    int max_frames = pre.max_frames();
+    if (pre.oversampling > 1) {
+      max_frames = std::min(max_frames, oversampled_frames_ / pre.oversampling);
+    }
+    if (max_frames > 0 && int(output.size()) > max_frames) {
+      RT_LOGW("VoiceManager: {} frames exceed the reserved {}", output.size(), max_frames);
+      render(output.first(max_frames));
+      render(output.subspan(max_frames));
+      return;
+    }
+
+    std::array<Voice*, max_voices_v> active;
+    int nactive = 0;
+    for (auto& voice : voices_) {
+      if (voice.is_active()) active[nactive++] = &voice;
+    }
+    pre.voices_in_use = nactive > 0 ? (active[nactive - 1] - voices_.data()) + 1 : 0;
+
+    pre.process(output.size());
+
+    TIME_SCOPE("Voices");
+    const int oversampling = pre.oversampling;
+    gsl::span<float> voice_output = output;
+    if (oversampling > 1) {
+      voice_output = oversampled_buffer(0, output.size() * oversampling);
+      std::fill(voice_output.begin(), voice_output.end(), 0.f);
+    }
+
+    auto& workers = Application::current().audio_manager->worker_pool();
+    int tasks = 1;
+    if (Voice::render_in_parallel && workers.enabled() && output.size() >= min_parallel_frames) {
+      tasks = std::min({workers.size() + 1, nactive / min_voices_per_task, max_voice_tasks});
+    }
+
+    if (tasks <= 1) {
+      for (int i = 0; i < nactive; i++) active[i]->process(voice_output);
+    } else {
+      // The first task renders straight into the output, the others into scratch buffers
+      auto& buffer_pool = Application::current().audio_manager->buffer_pool();
+      auto scratch = buffer_pool.allocate_multi<max_voice_tasks - 1>();
+      std::array<gsl::span<float>, max_voice_tasks> outputs = {voice_output};
+      for (int task = 1; task < tasks; task++) {
+        outputs[task] = oversampling > 1
+                          ? oversampled_buffer(task, voice_output.size())
+                          : gsl::span<float>(scratch[task - 1].data(), output.size());
+      }
+      workers.parallel_for(tasks, [&](int task) {
+        gsl::span<float> out = outputs[task];
+        if (task > 0) std::fill(out.begin(), out.end(), 0.f);
+        // Interleave the voices, so voices that started together are spread out
+        for (int i = task; i < nactive; i += tasks) active[i]->process(out);
+      });
+      for (int task = 1; task < tasks; task++) {
+        util::audio::mix_add(voice_output.data(), outputs[task].data(), voice_output.size());
+      }
+    }
+
+    if (oversampling > 1) {
+      decimator_.process(output.data(), voice_output.data(), output.size(), oversampling);
+    }
+
+    post.process(output);
+  }
+
+  template<typename V, int N>
+  void VoiceManager<V, N>::oversampling(int factor) noexcept
+  {
+    if (oversampled_.empty()) {
+      reserve_oversampled(Application::current().audio_manager->buffer_size());
+    }
+    pre.oversampling = factor >= 4 ? 4 : factor >= 2 ? 2 : 1;
+  }
+
+  template<typename V, int N>
+  void VoiceManager<V, N>::reserve_oversampled(int buffer_size)
+  {
+    oversampled_frames_ = max_oversampling * buffer_size;
+    oversampled_.assign(std::size_t(oversampled_frames_) * max_voice_tasks, 0.f);
+  }
+
+  template<typename V, int N>
+  gsl::span<float> VoiceManager<V, N>::oversampled_buffer(int task, int nframes) noexcept
+  {
+    OTTO_ASSERT(nframes <= oversampled_frames_);
+    return {oversampled_.data() + task * oversampled_frames_, nframes};
+  }
+
   template<typename V, int N>
   auto VoiceManager<V, N>::handle_midi_on(const midi::NoteOnEvent& evt) noexcept -> Voice&
   {
@@ -199,7 +349,10 @@ namespace otto::core::voices {
   template<typename V, int N>
   void VoiceManager<V, N>::handle_pitch_bend(const midi::PitchBendEvent& evt) noexcept
   {
-    pitch_bend_ = powf(2.f, ((float)evt.value / 8192.f) - 1.f);
+    auto pitch_bend = powf(2.f, ((float)evt.value / 8192.f) - 1.f);
+    for (auto& voice : voices_) {
+      voice.pitch_bend_ = pitch_bend;
+    }
   }
 
   template<typename V, int N>
@@ -214,24 +367,71 @@ namespace otto::core::voices {
   template<typename V, int N>
   audio::ProcessData<1> VoiceManager<V, N>::process(audio::ProcessData<1> data) noexcept
   {
+    auto& governor = Application::current().audio_manager->load_governor();
+    int limit = governor.voice_limit(settings_props.voice_count);
+    if (limit < voice_limit_) shed_voices(limit);
+    voice_limit_ = limit;
+
+    auto buf = Application::current().audio_manager->buffer_pool().allocate_clear();
+    auto nframes = static_cast<int>(buf.size());
+    int cursor = 0;
+    midi::sort_by_time(data.midi);
     for (auto& evt : data.midi) {
+      auto time = std::clamp(midi::time_of(evt), cursor, nframes);
+      if (time > cursor) {
+        render({buf.data() + cursor, time - cursor});
+        cursor = time;
+      }
       util::match(evt, [&](midi::NoteOnEvent& evt) { handle_midi_on(evt); },
                   [&](midi::NoteOffEvent& evt) { handle_midi_off(evt); },
                   [&](midi::ControlChangeEvent& evt) { handle_control_change(evt); },
                   [&](midi::PitchBendEvent& evt) { handle_pitch_bend(evt); },
                   [](auto&) {});
     }
-    auto buf = Application::current().audio_manager->buffer_pool().allocate();
-    for (auto& frm : buf) {
-      frm = (*this)();
+    if (cursor < nframes) {
+      render({buf.data() + cursor, nframes - cursor});
     }
     return data.redirect(buf);
   }
 
+  template<typename V, int N>
+  void VoiceManager<V, N>::reset_voices() noexcept
+  {
+    util::for_each(voices_, &Voice::release);
+    note_stack.clear();
+    free_voices.clear();
+
+    switch (settings_props.play_mode.get()) {
+    case PlayMode::unison:
+      // TODO: Can not be implemented this way
+      [[fallthrough]];
+    case PlayMode::mono: free_voices.push_back(&voices_[0]); break;
+    case PlayMode::poly:
+      for (int i = 0; i < settings_props.voice_count; i++) free_voices.push_back(&voices_[i]);
+    }
+  }
+
+  template<typename V, int N>
+  void VoiceManager<V, N>::shed_voices(int limit) noexcept
+  {
+    int in_use = std::count_if(note_stack.begin(), note_stack.end(),
+                               [](auto& nvp) { return nvp.has_voice(); });
+    for (auto& nvp : note_stack) {
+      if (in_use <= limit) break;
+      if (!nvp.has_voice()) continue;
+      nvp.voice->release();
+      free_voices.push_back(nvp.voice);
+      nvp.voice = nullptr;
+      in_use--;
+    }
+  }
+
   template<typename V, int N>
   auto VoiceManager<V, N>::get_voice(int key) noexcept -> Voice&
   {
-    if (free_voices.size() > 0) {
+    int in_use = std::count_if(note_stack.begin(), note_stack.end(),
+                               [](auto& nvp) { return nvp.has_voice(); });
+    if (free_voices.size() > 0 && in_use < voice_limit_) {
       auto it = util::find_if(note_stack, [key](NoteVoicePair& nvp) { return nvp.note == key; });
       auto fvit = it == note_stack.end() ? free_voices.begin() : util::find(free_voices, it->voice);
       auto& v = **fvit;
@@ -283,7 +483,7 @@ namespace otto::core::voices {
   }
 
   template<typename V, int N>
-  auto VoiceManager<V, N>::voices() -> std::array<Voice, voice_count_v>&
+  auto VoiceManager<V, N>::voices() -> std::array<Voice, max_voices_v>&
   {
     return voices_;
   }
@@ -41,10 +41,6 @@ namespace otto::engines {
 
   Chorus::Chorus() : EffectEngine<Chorus>(std::make_unique<ChorusScreen>(this))
   {
-    // Initialize LPF for param smoothening
-    lpf.type(gam::SMOOTHING);
-    lpf.freq(1000);
-
     // Set proper size of phase accumulator for graphics
     phase.radius(1);
 
@@ -56,20 +52,18 @@ namespace otto::engines {
     });
 
     props.feedback.on_change().connect([this](float fbk) { chorus.fbk(fbk); });
-
-    props.depth.on_change().connect([this](float depth) {
-      chorus.depth(depth);
-    });
   }
 
   audio::ProcessData<2> Chorus::process(audio::ProcessData<1> data)
   {
     // Allocate two audio buffers (left and right channels)
     auto buf = Application::current().audio_manager->buffer_pool().allocate_multi<2>();
+    // Smooth the depth param to reduce cracks in sound
+    auto& depth = props.depth.smoother();
+    chorus.depth(depth.value());
     // Fill buffers with processed samples
     for (auto&& [dat, bufL, bufR] : util::zip(data.audio, buf[0], buf[1])) {
-      // Apply smoothening filter to depth param to reduce cracks in sound
-      chorus.depth(lpf(props.depth));
+      if (depth.is_smoothing()) chorus.depth(depth.next());
       // Get one sample from chorus effect
       chorus(dat, bufL, bufR);
       // Update phase value for graphics
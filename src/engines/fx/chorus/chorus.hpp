@@ -17,7 +17,7 @@ namespace otto::engines {
 
     struct Props {
       Property<float> delay = {0.0001, limits(0.0001, 0.0086), step_size(0.0001)};
-      Property<float> depth = {0.0001, limits(0.0001, 0.008), step_size(0.0001)};
+      Property<float, smoothed> depth = {0.0001, limits(0.0001, 0.008), step_size(0.0001)};
       Property<float> feedback = {0.1, limits(0, 0.9), step_size(0.01)};
       Property<float> rate = {0, limits(0, 2), step_size(0.1)};
 
@@ -32,7 +32,6 @@ namespace otto::engines {
 
   private:
     gam::Chorus<> chorus;
-    gam::OnePole<> lpf;
     gam::AccumPhase<> phase;
 
 
@@ -43,13 +43,24 @@ namespace otto::engines {
 
   audio::ProcessData<2> Wormhole::process(audio::ProcessData<1> data)
   {
-    auto buf = Application::current().audio_manager->buffer_pool().allocate_multi<2>();
-    for (auto&& [dat, bufL, bufR] : util::zip(data.audio, buf[0], buf[1])) {
-      auto frm = reverb(pre_filter(dat) + last_sample * shimmer_amount);
-      last_sample = dc_block(shimmer_filter(pitchshifter(frm)));
-
-      bufL = output_delay[0](frm);
-      bufR = output_delay[1](frm);
+    auto& audio_manager = *Application::current().audio_manager;
+    auto buf = audio_manager.buffer_pool().allocate_multi<2>();
+    // The shimmer is the most expensive part, and is the first to go when the CPU is busy
+    if (shimmer_amount > 0 && audio_manager.load_governor().full_quality()) {
+      for (auto&& [dat, bufL, bufR] : util::zip(data.audio, buf[0], buf[1])) {
+        auto frm = reverb(pre_filter(dat) + last_sample * shimmer_amount);
+        last_sample = dc_block(shimmer_filter(pitchshifter(frm)));
+
+        bufL = output_delay[0](frm);
+        bufR = output_delay[1](frm);
+      }
+    } else {
+      last_sample = 0;
+      for (auto&& [dat, bufL, bufR] : util::zip(data.audio, buf[0], buf[1])) {
+        auto frm = reverb(pre_filter(dat));
+        bufL = output_delay[0](frm);
+        bufR = output_delay[1](frm);
+      }
     }
     return data.redirect(buf);
   }
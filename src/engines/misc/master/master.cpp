@@ -2,7 +2,7 @@
 
 #include "core/ui/vector_graphics.hpp"
 
-#include "util/iterator.hpp"
+#include "util/audio.hpp"
 #include "util/utility.hpp"
 
 namespace otto::engines {
@@ -24,11 +24,12 @@ namespace otto::engines {
 
   audio::ProcessData<2> Master::process(audio::ProcessData<2> data)
   {
-    for (auto&& l : data.audio[0]) {
-      l *= props.volume * props.volume * 0.80;
-    }
-    for (auto&& r : data.audio[1]) {
-      r *= props.volume * props.volume * 0.80;
+    auto& volume = props.volume.smoother();
+    auto gain = [](float vol) { return vol * vol * 0.80f; };
+    float from = gain(volume.value());
+    float to = gain(volume.skip(data.nframes));
+    for (auto& channel : data.audio) {
+      util::audio::gain_ramp(channel.data(), data.nframes, from, to);
     }
     return data;
   }
@@ -12,7 +12,7 @@ namespace otto::engines {
     static constexpr util::string_ref name = "Master";
 
     struct Props {
-      Property<float> volume = {0.5, limits(0, 1), step_size(0.01)};
+      Property<float, smoothed> volume = {0.5, limits(0, 1), step_size(0.01)};
 
       DECL_REFLECTION(Props, volume);
     } props;
@@ -98,16 +98,19 @@ namespace otto::engines {
     // Check for beat. will be obsolete with master clock
     auto next_beat = (_samples_per_beat - _counter) % _samples_per_beat;
 
-    // If we are running, at a note-off point, and the output stack is not empty send note-off
-    // events
-    if (next_beat <= _samples_per_beat - note_off_frames && running_ && !props.output_stack_.empty()) {
+    // If we are running, the note-off point falls in this block, and the output stack is not
+    // empty, send note-off events at that frame
+    bool note_off_in_block =
+      _counter <= note_off_frames && note_off_frames < _counter + int(data.nframes);
+    if (note_off_in_block && running_ && !props.output_stack_.empty()) {
+      int off_time = note_off_frames - _counter;
       for (auto ev : *iter) {
-        data.midi.push_back(midi::NoteOffEvent(ev.key));
+        data.midi.push_back(midi::NoteOffEvent(ev.key, 1, 0, off_time));
       }
     }
 
     // If we are running, and at a new beat, do stuff.
-    if (next_beat <= data.nframes && running_) {
+    if (next_beat < int(data.nframes) && running_) {
       // Resort notes. Wait until this point to make sure that off events have been sent
       if (has_changed_) {
         sort_notes();
@@ -118,6 +121,7 @@ namespace otto::engines {
       // increment in output stack (wrapping) and push new notes
       iter++;
       for (auto ev : *iter) {
+        ev.time = next_beat;
         data.midi.push_back(ev);
       }
     }
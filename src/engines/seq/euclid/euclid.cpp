@@ -107,20 +107,21 @@ namespace otto::engines {
       return data;
     }
 
-    auto next_beat = _samples_per_beat - _counter;
+    // A beat that lands on the end of the block is frame 0 of the next one
+    int next_beat = (_samples_per_beat - _counter) % _samples_per_beat;
 
-    if (next_beat <= data.nframes) {
+    if (next_beat < int(data.nframes)) {
       for (auto& channel : props.channels) {
         if (channel.length > 0) {
           channel._beat_counter++;
           channel._beat_counter %= channel.length;
           for (auto& note : channel.notes.get()) {
-            if (note >= 0) data.midi.push_back(midi::NoteOffEvent(note));
+            if (note >= 0) data.midi.push_back(midi::NoteOffEvent(note, 1, 0, next_beat));
           }
           if (running && channel._hits_enabled.at(channel._beat_counter)) {
             for (auto note : channel.notes.get()) {
               if (note >= 0) {
-                data.midi.push_back(midi::NoteOnEvent(note));
+                data.midi.push_back(midi::NoteOnEvent(note, 1, 0, next_beat));
               }
             }
           }
@@ -1,8 +1,11 @@
 #include "core/ui/vector_graphics.hpp"
 #include "ottofm.hpp"
 
+#include <utility>
+
 #include "services/application.hpp"
 #include "services/ui_manager.hpp"
+#include "util/audio.hpp"
 
 namespace otto::engines {
 
@@ -111,55 +114,122 @@ namespace otto::engines {
 
 
 
-  /*
-   * Declarations
-   */
+  namespace {
+    using Operators = std::array<OTTOFMSynth::FMOperator, 4>;
 
-  float OTTOFMSynth::Voice::algos(int alg)
-  {
-    switch (alg) {
-    case 0: return operators[0](operators[1](operators[2](operators[3](0))));
-    case 1: return operators[0](operators[1](operators[2](0) + operators[3](0)));
-    case 2: return operators[0](operators[1](operators[2](0)) + operators[3](0));
-    case 3: {
-      float aux = operators[3](0);
-      return operators[0](operators[1](aux) + operators[2](aux));
-    }
-    case 4: {
-      float aux = operators[2](operators[3](0));
-      return operators[0](aux) + operators[1](aux);
-    }
-    case 5: return operators[0](0) + operators[1](operators[2](operators[3](0)));
-    case 6: return operators[0](operators[1](0) + operators[2](0) + operators[3](0));
-    case 7: return operators[0](operators[1](0)) + operators[2](operators[3](0));
-    case 8: {
-      float aux = operators[3](0);
-      return operators[0](aux) + operators[1](aux) + operators[2](aux);
+    /// Render `n` frames of algorithm `Alg`, scaled by the voice envelope, and add them to `out`
+    ///
+    /// The operators are in the order of the screen, with operator 0 at the bottom, and which
+    /// are modulators matches `algorithms[Alg]`. Each operator renders the whole chunk before the
+    /// ones it modulates, into zeroed scratch buffers that it adds to.
+    template<int Alg>
+    void render_algorithm(Operators& op, float* out, const float* env, int n) noexcept
+    {
+      constexpr int N = OTTOFMSynth::FMOperator::block_size;
+      float sum[N] = {}, a[N] = {}, b[N] = {}, c[N] = {};
+      if constexpr (Alg == 0) {
+        op[3].modulator(a, nullptr, n);
+        op[2].modulator(b, a, n);
+        op[1].modulator(c, b, n);
+        op[0].carrier(sum, c, n);
+      } else if constexpr (Alg == 1) {
+        op[2].modulator(a, nullptr, n);
+        op[3].modulator(a, nullptr, n);
+        op[1].modulator(b, a, n);
+        op[0].carrier(sum, b, n);
+      } else if constexpr (Alg == 2) {
+        op[2].modulator(a, nullptr, n);
+        op[1].modulator(b, a, n);
+        op[3].modulator(b, nullptr, n);
+        op[0].carrier(sum, b, n);
+      } else if constexpr (Alg == 3) {
+        op[3].modulator(a, nullptr, n);
+        op[1].modulator(b, a, n);
+        op[2].modulator(b, a, n);
+        op[0].carrier(sum, b, n);
+      } else if constexpr (Alg == 4) {
+        op[3].modulator(a, nullptr, n);
+        op[2].modulator(b, a, n);
+        op[0].carrier(sum, b, n);
+        op[1].carrier(sum, b, n);
+      } else if constexpr (Alg == 5) {
+        op[0].carrier(sum, nullptr, n);
+        op[3].modulator(a, nullptr, n);
+        op[2].modulator(b, a, n);
+        op[1].carrier(sum, b, n);
+      } else if constexpr (Alg == 6) {
+        op[1].modulator(a, nullptr, n);
+        op[2].modulator(a, nullptr, n);
+        op[3].modulator(a, nullptr, n);
+        op[0].carrier(sum, a, n);
+      } else if constexpr (Alg == 7) {
+        op[1].modulator(a, nullptr, n);
+        op[0].carrier(sum, a, n);
+        op[3].modulator(b, nullptr, n);
+        op[2].carrier(sum, b, n);
+      } else if constexpr (Alg == 8) {
+        op[3].modulator(a, nullptr, n);
+        op[0].carrier(sum, a, n);
+        op[1].carrier(sum, a, n);
+        op[2].carrier(sum, a, n);
+      } else if constexpr (Alg == 9) {
+        op[0].carrier(sum, nullptr, n);
+        op[1].carrier(sum, nullptr, n);
+        op[3].modulator(a, nullptr, n);
+        op[2].carrier(sum, a, n);
+      } else {
+        static_assert(Alg == 10);
+        for (auto& o : op) o.carrier(sum, nullptr, n);
+      }
+      for (int i = 0; i < n; i++) {
+        out[i] += env[i] * sum[i];
+      }
     }
-    case 9: return operators[0](0) + operators[1](0) + operators[2](operators[3](0));
-    case 10: return operators[0](0) + operators[1](0) + operators[2](0) + operators[3](0);
-    default: return 0.f;
+
+    using AlgorithmKernel = void (*)(Operators&, float*, const float*, int) noexcept;
+
+    template<int... Algs>
+    constexpr std::array<AlgorithmKernel, sizeof...(Algs)> make_kernels(
+      std::integer_sequence<int, Algs...>) noexcept
+    {
+      return {&render_algorithm<Algs>...};
     }
-  }
 
-  float OTTOFMSynth::FMOperator::FMSine::operator()(float phsOffset = 0) noexcept
+    /// The kernel of each algorithm, indexed by `props.algN`
+    constexpr auto algorithm_kernels = make_kernels(std::make_integer_sequence<int, 11>());
+    static_assert(algorithm_kernels.size() == std::tuple_size_v<decltype(algorithms)>);
+  } // namespace
+
+  void OTTOFMSynth::FMOperator::modulator(float* out, const float* mod, int n) noexcept
   {
-    return gam::scl::sinP9(gam::scl::wrap(this->nextPhase() + phsOffset, 1.f, -1.f));
+    float osc[block_size], amp[block_size];
+    sine.process(osc, mod, n);
+    const float gain = outlevel * fm_amount;
+    for (int i = 0; i < n; i += oversampling) {
+      std::fill_n(amp + i, oversampling, env() * gain);
+    }
+    for (int i = 0; i < n; i++) out[i] += osc[i] * amp[i];
   }
 
-  float OTTOFMSynth::FMOperator::operator()(float phaseMod = 0)
+  void OTTOFMSynth::FMOperator::carrier(float* out, const float* mod, int n) noexcept
   {
-    if (modulator)
-      return env() * sine(phaseMod) * outlevel * fm_amount;
-    else {
-      previous_value = sine(phaseMod + feedback * previous_value) * outlevel;
-      return previous_value;
+    if (feedback == 0) {
+      float osc[block_size];
+      sine.process(osc, mod, n);
+      util::audio::mix_add(out, osc, n, outlevel);
+      previous_value = osc[n - 1] * outlevel;
+      return;
+    }
+    // Each frame feeds back into the next one, so this can't be vectorized
+    for (int i = 0; i < n; i++) {
+      previous_value = sine.next((mod ? mod[i] : 0) + feedback * previous_value) * outlevel;
+      out[i] += previous_value;
     }
   }
 
   void OTTOFMSynth::FMOperator::freq(float frq)
   {
-    sine.freq(frq);
+    sine.freq(frq, gam::sampleRate() * oversampling);
   }
 
   float OTTOFMSynth::FMOperator::level()
@@ -182,10 +252,26 @@ namespace otto::engines {
   }
 
   // Voice
-  float OTTOFMSynth::Voice::operator()() noexcept
+  void OTTOFMSynth::Voice::process(gsl::span<float> output) noexcept
   {
-    set_frequencies();
-    return algos(props.algN);
+    if (pre.oversampling != oversampling) {
+      oversampling = pre.oversampling;
+      for (auto& op : operators) op.oversampling = oversampling;
+      tuned_frequency = -1;
+    }
+    auto kernel = algorithm_kernels[props.algN];
+    std::array<float, FMOperator::block_size> env;
+    for (int offset = 0; offset < output.size(); offset += env.size()) {
+      auto length = std::min<std::ptrdiff_t>(env.size(), output.size() - offset);
+      // Glide and pitch bend are applied once per chunk. The envelope is rendered at the output
+      // rate, and held for the oversampled frames.
+      render_envelope({env.data(), length / oversampling});
+      if (oversampling > 1) {
+        for (auto i = length - 1; i >= 0; i--) env[i] = env[i / oversampling];
+      }
+      set_frequencies();
+      kernel(operators, output.data() + offset, env.data(), length);
+    }
   }
 
   OTTOFMSynth::Voice::Voice(Pre& pre) noexcept : VoiceBase(pre)
@@ -194,12 +280,6 @@ namespace otto::engines {
       operators[i].env.finish();
     }
     /// Connect appropriate voice properties
-    props.algN.on_change().connect([this](int algo) {
-      // Change modulator flags
-      for (int i = 0; i < 4; i++) {
-        operators[i].modulator = algorithms[algo].modulator_flags[i];
-      }
-    });
     props.fmAmount.on_change().connect([this](float fm) {
       // Change modulator flags
       for (int i = 0; i < 4; i++) {
@@ -211,10 +291,14 @@ namespace otto::engines {
     for (int i = 0; i < 4; i++) {
       props.operators[i].outLev.on_change().connect(
         [this, i](float level) { operators[i].outlevel = level; });
-      props.operators[i].detune.on_change().connect(
-        [this, i](float detune) { operators[i].detune_amount = detune * 25; });
-      props.operators[i].ratio_idx.on_change().connect(
-        [this, i](int idx) { operators[i].freq_ratio = (float) fractions[idx]; });
+      props.operators[i].detune.on_change().connect([this, i](float detune) {
+        operators[i].detune_amount = detune * 25;
+        tuned_frequency = -1;
+      });
+      props.operators[i].ratio_idx.on_change().connect([this, i](int idx) {
+        operators[i].freq_ratio = (float) fractions[idx];
+        tuned_frequency = -1;
+      });
       props.operators[i].mAtt.on_change().connect(
         [this, i](float att) { operators[i].env.attack(3 * att); });
       props.operators[i].mDecrel.on_change().connect([this, i](float decrel) {
@@ -244,6 +328,8 @@ namespace otto::engines {
 
   void OTTOFMSynth::Voice::set_frequencies()
   {
+    if (frequency() == tuned_frequency) return;
+    tuned_frequency = frequency();
     for (int i = 0; i < 4; i++) {
       operators[i].freq(frequency() * operators[i].freq_ratio + operators[i].detune_amount);
     }
@@ -257,18 +343,18 @@ namespace otto::engines {
   /// Constructor. Takes care of linking appropriate variables to props
   OTTOFMSynth::Post::Post(Pre& pre) noexcept : PostBase(pre) {}
 
-  float OTTOFMSynth::Post::operator()(float in) noexcept
+  void OTTOFMSynth::Post::process(gsl::span<float>) noexcept
   {
     if (pre.last_voice) {
+      auto& modulators = algorithms[props.algN].modulator_flags;
       for (int i = 0; i < 4; i++) {
-        if (pre.last_voice->operators[i].modulator)
+        if (modulators[i])
           props.operators[i].current_level = pre.last_voice->operators[i].level();
         else
           props.operators[i].current_level =
             pre.last_voice->envelope() * pre.last_voice->operators[i].outlevel;
       }
     }
-    return in;
   }
 
   // OTTOFMSynth ////////////////////////////////////////////////////////////////
@@ -299,7 +385,11 @@ namespace otto::engines {
 
   OTTOFMSynth::OTTOFMSynth()
     : SynthEngine<OTTOFMSynth>(std::make_unique<OTTOFMSynthScreen>(this)), voice_mgr_(props)
-  {}
+  {
+    props.quality.on_change()
+      .connect([this](int quality) { voice_mgr_.oversampling(1 << quality); })
+      .call_now(props.quality);
+  }
 
   bool OTTOFMSynthScreen::keypress(Key key)
   {
@@ -4,7 +4,8 @@
 #include "core/voices/voice_manager.hpp"
 
 #include <Gamma/Envelope.h>
-#include <Gamma/Oscillator.h>
+
+#include "util/dsp/pm_sine.hpp"
 
 namespace otto::engines {
 
@@ -33,29 +34,27 @@ namespace otto::engines {
     struct Props {
       Property<int> algN = {0, limits(0, 10), step_size(1)};
       Property<float> fmAmount = {1, limits(0, 1), step_size(0.01)};
+      /// Oversampling, against aliasing at high ratios and feedback. 0: off, 1: 2x, 2: 4x.
+      /// Each step roughly doubles the CPU use of the voices.
+      Property<int> quality = {0, limits(0, 2), step_size(1)};
 
       std::array<OperatorProps, 4> operators;
 
-      DECL_REFLECTION(Props, algN, fmAmount, operators);
+      DECL_REFLECTION(Props, algN, fmAmount, quality, operators);
     } props;
 
     struct FMOperator {
-      // Custom version of the 'Sine' in Gamma. We need to call it with a phase offset
-      // instead of a frequency offset. (Phase modulation, not frequency modulation)
-      struct FMSine : public gam::AccumPhase<> {
-        FMSine(float frq = 440, float phs = 0) : AccumPhase<>(frq, phs, 1) {}
-        /// Generate next sample with phase offset
-        float operator()(float) noexcept;
-      };
+      /// Operators render in chunks of at most this many frames
+      static constexpr int block_size = 64;
 
       FMOperator(float frq = 440, float outlevel = 1, bool modulator = false) {}
 
-      FMSine sine;
+      /// Phase modulation, not frequency modulation
+      util::dsp::PMSine sine;
       gam::ADSR<> env;
 
-      bool modulator = false; /// If it is a modulator, use the envelope.
       float outlevel = 1;
-      float feedback = 0; /// TODO:Implement in call operator
+      float feedback = 0;
       float fm_amount = 1;
 
       float freq_ratio = 1;
@@ -63,7 +62,20 @@ namespace otto::engines {
 
       float previous_value = 0;
 
-      float operator()(float);
+      /// Frames rendered per output frame. The envelope advances once per output frame.
+      int oversampling = 1;
+
+      /// Render `n` frames as a modulator, scaled by its own envelope and the FM amount, and add
+      /// them to `out`
+      ///
+      /// @param mod the phase modulation, or `nullptr` for none
+      void modulator(float* out, const float* mod, int n) noexcept;
+
+      /// Render `n` frames as a carrier, with feedback, and add them to `out`. The voice applies
+      /// its own envelope.
+      ///
+      /// @param mod the phase modulation, or `nullptr` for none
+      void carrier(float* out, const float* mod, int n) noexcept;
 
       void freq(float); /// Set frequency
 
@@ -93,32 +105,37 @@ namespace otto::engines {
     };
 
     struct Voice : voices::VoiceBase<Voice, Pre> {
-      // The workhorse. Implements the FM algorithms.
-      float algos(int);
-
       std::array<FMOperator, 4> operators;
 
       void reset_envelopes();
       void release_envelopes();
 
+      /// Update the operator frequencies, if the voice frequency has changed since the last call
       void set_frequencies();
 
       Voice(Pre&) noexcept;
 
-      float operator()() noexcept;
+      /// Render a block with the current algorithm. The algorithm is picked once per block.
+      void process(gsl::span<float> output) noexcept;
       void on_note_on() noexcept;
       void on_note_off() noexcept;
 
     private:
       friend struct OTTOFMSynthScreen;
+
+      /// The voice frequency the operators are tuned to. Negative when they need retuning
+      float tuned_frequency = -1;
+      /// The oversampling the operators are set up for
+      int oversampling = 1;
     };
 
     struct Post : voices::PostBase<Post, Voice> {
       Post(Pre&) noexcept;
 
-      float operator()(float) noexcept;
+      /// Updates the operator levels shown on the screen, once per block
+      void process(gsl::span<float>) noexcept;
     };
 
-    voices::VoiceManager<Post, 6> voice_mgr_;
+    voices::VoiceManager<Post, voices::max_voices> voice_mgr_;
   };
 } // namespace otto::engines
@@ -89,7 +89,7 @@ namespace otto::engines {
 
   audio::ProcessData<1> Sampler::process(audio::ProcessData<1> data)
   {
-    for (auto& ev : data.midi) {
+    auto handle = [this](midi::AnyMidiEvent& ev) {
       util::match(ev,
                   [this](midi::NoteOnEvent& ev) {
                     note_on = true;
@@ -100,10 +100,21 @@ namespace otto::engines {
                     if (props.cut) finish();
                   },
                   [](auto&&) {});
-    }
+    };
+    midi::sort_by_time(data.midi);
+    auto next_event = data.midi.begin();
+    int frame = 0;
     for (auto&& frm : data.audio) {
+      for (; next_event != data.midi.end() && midi::time_of(*next_event) <= frame; ++next_event) {
+        handle(*next_event);
+      }
       frm = _hi_filter(_lo_filter(sample())) * props.volume;
       if (props.loop && note_on && sample.done()) restart();
+      frame++;
+    }
+    // Events scheduled past the end of the block
+    for (; next_event != data.midi.end(); ++next_event) {
+      handle(*next_event);
     }
     return data;
   }
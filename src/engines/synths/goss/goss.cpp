@@ -25,82 +25,191 @@ namespace otto::engines {
     : SynthEngine<GossSynth>(std::make_unique<GossSynthScreen>(this)), voice_mgr_(props)
   {}
 
-  float GossSynth::Voice::operator()() noexcept
+  namespace {
+    using Wavetable = GossSynth::Wavetable;
+    constexpr int table_size = GossSynth::table_size;
+
+    /// `sin(2pi * i / table_size)` for `i` in the first quarter of the table, by Taylor series,
+    /// as `std::sin` can not be used in constant expressions
+    constexpr double quarter_sine(int i) noexcept
+    {
+      double x = 2 * M_PI * i / table_size;
+      double term = x;
+      double res = x;
+      for (int n = 1; n < 12; n++) {
+        term *= -x * x / ((2 * n) * (2 * n + 1));
+        res += term;
+      }
+      return res;
+    }
+
+    /// One cycle of a sine, `table_size` long
+    constexpr std::array<double, table_size> make_sine() noexcept
+    {
+      constexpr int q = table_size / 4;
+      std::array<double, table_size> res = {};
+      for (int i = 0; i <= q; i++) {
+        double s = quarter_sine(i);
+        res[i] = s;
+        res[2 * q - i] = s;
+        res[(2 * q + i) % table_size] = -s;
+        res[(4 * q - i) % table_size] = -s;
+      }
+      return res;
+    }
+
+    /// A sum of harmonics, each an integer number of `cycles` per table, at `amp`
+    constexpr Wavetable make_table(const std::array<double, table_size>& sine,
+                                   std::initializer_list<std::pair<int, double>> harmonics) noexcept
+    {
+      Wavetable res = {};
+      for (int i = 0; i < table_size; i++) {
+        double sum = 0;
+        for (auto [cycles, amp] : harmonics) sum += amp * sine[(cycles * i) % table_size];
+        res[i] = static_cast<float>(sum);
+      }
+      res[table_size] = res[0];
+      return res;
+    }
+
+    constexpr GossSynth::Wavetables make_wavetables() noexcept
+    {
+      constexpr auto sine = make_sine();
+      return {{{
+                make_table(sine, {{1, 1}, {3, 1}, {2, 1}}),
+                make_table(sine, {{4, 1}, {16, 0.3}}),
+                make_table(sine, {{6, 0.5}, {8, 1}, {10, 0.5}, {12, 1}, {16, 0.5}}),
+              }},
+              make_table(sine, {{4, 0.5}, {6, 1.0}})};
+    }
+
+    constexpr GossSynth::Wavetables wavetables = make_wavetables();
+
+    /// Linearly interpolated lookup. `phase` must be in `[0, 1)`
+    float lookup(const Wavetable& table, float phase) noexcept
+    {
+      float pos = phase * table_size;
+      int idx = static_cast<int>(pos);
+      float frac = pos - idx;
+      return table[idx] + frac * (table[idx + 1] - table[idx]);
+    }
+  } // namespace
+
+  void GossSynth::Voice::process(gsl::span<float> output) noexcept
   {
-    float fundamental = frequency() * (1 + 0.015 * props.leslie * pre.pitch_modulation_hi.cos()) * 0.5;
-    pipes[0].freq(fundamental);
-    pipes[1].freq(fundamental);
-    pipes[2].freq(fundamental);
-    percussion.freq(frequency());
-    return pipes[0]() + pipes[1]() * props.drawbar1 + pipes[2]() * props.drawbar2 + percussion() * perc_env();
+    std::array<float, 64> env;
+    for (int offset = 0; offset < output.size(); offset += env.size()) {
+      auto length = std::min<std::ptrdiff_t>(env.size(), output.size() - offset);
+      auto chunk = output.subspan(offset, length);
+      render_envelope({env.data(), chunk.size()});
+      for (int i = 0; i < chunk.size(); i++) {
+        float phase = pre.lanes.phase_at(lane, offset + i);
+        float perc_phase = phase * 2;
+        perc_phase -= static_cast<int>(perc_phase);
+        float drawbar1 = pre.drawbars[0] + pre.drawbar_steps[0] * (offset + i);
+        float drawbar2 = pre.drawbars[1] + pre.drawbar_steps[1] * (offset + i);
+        float s = lookup(tables.pipes[0], phase) + lookup(tables.pipes[1], phase) * drawbar1 +
+                  lookup(tables.pipes[2], phase) * drawbar2 +
+                  lookup(tables.percussion, perc_phase) * pre.lanes.level_at(lane, offset + i);
+        chunk[i] += env[i] * s;
+      }
+    }
+    // Used for the next segment, see Pre::lanes
+    pre.lanes.frequency[lane] = frequency();
   }
 
-  GossSynth::Voice::Voice(Pre& pre) noexcept : VoiceBase(pre) {
-    pipes[0].resize(1024);
-    pipes[0].addSine(1, 1, 0);
-    pipes[0].addSine(3, 1, 0);
-    pipes[0].addSine(2, 1, 0);
-
-    pipes[1].resize(1024);
-    pipes[1].addSine(4, 1, 0);
-    pipes[1].addSine(16, 0.3, 0);
-
-    pipes[2].resize(1024);
-    pipes[2].addSine(6, 0.5, 0);
-    pipes[2].addSine(8, 1, 0);
-    pipes[2].addSine(10, 0.5, 0);
-    pipes[2].addSine(12, 1, 0);
-    pipes[2].addSine(16, 0.5, 0);
-
-    percussion.resize(1024);
-    percussion.addSine(4, 0.5, 0);
-    percussion.addSine(6, 1.0, 0);
-
-    perc_env.decay(0.5);
-    perc_env.finish();
+  GossSynth::Voice::Voice(Pre& pre) noexcept
+    : VoiceBase(pre), tables(wavetables), lane(pre.lanes.claim())
+  {
+    // -60dB over 0.5 seconds
+    pre.lanes.decay[lane] = std::pow(0.001f, 1.f / (0.5f * gam::Domain::master().spu()));
+    pre.lanes.level[lane] = 0;
   }
 
-  void GossSynth::Voice::on_note_on() noexcept {
-    perc_env.reset(props.click * 5);
+  void GossSynth::Voice::on_note_on() noexcept
+  {
+    pre.lanes.level[lane] = props.click * 5;
+    pre.lanes.frequency[lane] = frequency();
   }
 
   GossSynth::Pre::Pre(Props& props) noexcept : PreBase(props)
   {
-    leslie_filter_hi.phase(0.5);
-    leslie_filter_lo.phase(0.5);
     props.leslie.on_change().connect([this](float leslie) {
       leslie_speed_lo = leslie * 10;
       leslie_speed_hi = leslie * 3;
-      leslie_filter_hi.freq(leslie_speed_hi);
-      leslie_filter_lo.freq(leslie_speed_lo);
       leslie_amount_hi = leslie * 0.3;
       leslie_amount_lo = leslie * 0.5;
-      pitch_modulation_lo.freq(leslie_speed_hi);
-      pitch_modulation_hi.freq(leslie);
-      rotation.freq(leslie_speed_hi/4.f);
     }).call_now(props.leslie);
+    auto& audio_manager = *Application::current().audio_manager;
+    lanes.reserve(audio_manager.buffer_size());
+    // Engines are created before the driver settles on its buffer size
+    buffer_size_subscription =
+      audio_manager.events.buffer_size_change.subscribe([this](int bs) { lanes.reserve(bs); });
   }
 
-  void GossSynth::Pre::operator()() noexcept {
-    props.rotation_value = rotation.nextPhase();
+  GossSynth::Pre::~Pre() noexcept
+  {
+    Application::current().audio_manager->events.buffer_size_change.unsubscribe(
+      buffer_size_subscription);
+  }
+
+  void GossSynth::Pre::process(int nframes) noexcept
+  {
+    float spu = gam::Domain::master().spu();
+    // The screen only needs the rotor angle once per block
+    rotation_phase += leslie_speed_hi / 4.f * nframes / spu;
+    rotation_phase -= static_cast<int>(rotation_phase);
+    props.rotation_value = 2 * M_PI * rotation_phase;
+    // The vibrato is slow enough to be applied once per block
+    vibrato_phase += props.leslie * nframes / spu;
+    vibrato_phase -= static_cast<int>(vibrato_phase);
+    float vibrato = 1 + 0.015 * props.leslie * std::cos(2 * M_PI * vibrato_phase);
+    lanes.update_increments(vibrato * 0.5f / spu, voices_in_use);
+    lanes.process(nframes, voices_in_use);
+
+    auto advance = [nframes](auto& prop, float& start, float& step) {
+      auto& smoother = prop.smoother();
+      start = smoother.value();
+      step = (smoother.skip(nframes) - start) / nframes;
+    };
+    advance(props.drawbar1, drawbars[0], drawbar_steps[0]);
+    advance(props.drawbar2, drawbars[1], drawbar_steps[1]);
   }
 
-  /// Constructor. Takes care of linking appropriate variables to props
   GossSynth::Post::Post(Pre& pre) noexcept : PostBase(pre)
   {
-    lpf.type(gam::LOW_PASS);
-    lpf.freq(1800);
-    lpf.res(1);
-    hpf.type(gam::HIGH_PASS);
-    hpf.freq(1800);
-    hpf.res(1);
+    float sr = gam::Domain::master().spu();
+    crossover.set(0, util::dsp::BiquadCoefficients::lowpass(1800, 1, sr));
+    crossover.set(1, util::dsp::BiquadCoefficients::highpass(1800, 1, sr));
   }
 
-  float GossSynth::Post::operator()(float in) noexcept
+  util::simd::float4 GossSynth::Post::rotor_gains() const noexcept
   {
-    float s_lo = lpf(in) * (1 + pre.leslie_amount_lo * pre.leslie_filter_lo.cos());
-    float s_hi = hpf(in) * (1 + pre.leslie_amount_hi * pre.leslie_filter_hi.cos());
-    return s_lo + s_hi;
+    return {1 + pre.leslie_amount_lo * std::cos(2 * float(M_PI) * rotor_phases[0]),
+            1 + pre.leslie_amount_hi * std::cos(2 * float(M_PI) * rotor_phases[1]), 0, 0};
+  }
+
+  void GossSynth::Post::process(gsl::span<float> buffer) noexcept
+  {
+    using util::simd::float4;
+    const float spu = gam::Domain::master().spu();
+    float4 gains = rotor_gains();
+    for (int offset = 0; offset < buffer.size(); offset += rotor_chunk) {
+      int length = std::min<int>(rotor_chunk, buffer.size() - offset);
+      auto advance = [&](float& phase, float speed) {
+        phase += speed * length / spu;
+        phase -= static_cast<int>(phase);
+      };
+      advance(rotor_phases[0], pre.leslie_speed_lo);
+      advance(rotor_phases[1], pre.leslie_speed_hi);
+      float4 target = rotor_gains();
+      float4 step = (target - gains) * float4(1.f / length);
+      for (float& s : buffer.subspan(offset, length)) {
+        gains += step;
+        s = sum(crossover(s) * gains);
+      }
+      gains = target;
+    }
   }
 
   audio::ProcessData<1> GossSynth::process(audio::ProcessData<1> data)
@@ -2,11 +2,10 @@
 
 #include "core/engine/engine.hpp"
 
+#include "core/voices/voice_lanes.hpp"
 #include "core/voices/voice_manager.hpp"
 
-#include <Gamma/Filter.h>
-#include <Gamma/Oscillator.h>
-
+#include "util/dsp/biquad.hpp"
 #include "util/reflection.hpp"
 
 namespace otto::engines {
@@ -18,13 +17,19 @@ namespace otto::engines {
   struct GossSynth final : SynthEngine<GossSynth> {
     static constexpr util::string_ref name = "Goss";
 
+    /// Size of the wavetables. Must be a power of two
+    static constexpr int table_size = 1024;
+    /// A single cycle wavetable, with a guard point for interpolation. Starts on a cache line.
+    struct alignas(64) Wavetable : std::array<float, table_size + 1> {};
+
     struct Props {
-      Property<float> drawbar1 = {1, limits(0, 1), step_size(0.01)};
-      Property<float> drawbar2 = {0.5, limits(0, 1), step_size(0.01)};
+      Property<float, smoothed> drawbar1 = {1, limits(0, 1), step_size(0.01)};
+      Property<float, smoothed> drawbar2 = {0.5, limits(0, 1), step_size(0.01)};
       Property<float> click = {0.5, limits(0, 1), step_size(0.01)};
       Property<float> leslie = {0.3, limits(0, 1), step_size(0.01)};
 
-      float rotation_value;
+      /// Angle of the rotor on the screen. Updated once per block
+      float rotation_value = 0;
 
       DECL_REFLECTION(Props, drawbar1, drawbar2, click, leslie);
     } props;
@@ -47,40 +52,85 @@ namespace otto::engines {
       float leslie_amount_hi = 0.f;
       float leslie_amount_lo = 0.f;
 
-      gam::LFO<> leslie_filter_hi;
-      gam::LFO<> leslie_filter_lo;
-      gam::LFO<> pitch_modulation_lo;
-      gam::LFO<> pitch_modulation_hi;
-
-      gam::AccumPhase<> rotation;
+      /// Phase of the rotor on the screen, in cycles
+      float rotation_phase = 0.f;
+
+      /// Phase of the pipes and level of the percussion envelope for all voices.
+      ///
+      /// The pipe tables all run at the same frequency, so one phase per voice drives them all.
+      /// The percussion runs at twice that frequency.
+      ///
+      /// The frequencies are control rate. The phases of a segment are advanced before the
+      /// voices render it, at the frequency each voice left at the end of its previous segment,
+      /// so glide and pitch bend take effect one segment late. That is at most a block, and less
+      /// around midi events, which split the block.
+      voices::VoiceLanes<voices::max_voices> lanes;
+      float vibrato_phase = 0.f;
+
+      /// Smoothed drawbar levels at the start of the block, and their change per frame.
+      ///
+      /// The drawbars are shared by all voices, so they are advanced once per block, and
+      /// interpolated by the voices.
+      std::array<float, 2> drawbars = {0.f, 0.f};
+      std::array<float, 2> drawbar_steps = {0.f, 0.f};
 
       Pre(Props&) noexcept;
+      ~Pre() noexcept;
 
-      void operator()() noexcept;
+      void process(int nframes) noexcept;
+
+      /// The voice manager splits blocks longer than the lanes have room for
+      int max_frames() const noexcept
+      {
+        return lanes.capacity();
+      }
+
+    private:
+      /// Subscription to `AudioManager::Events::buffer_size_change`, which reserves the lanes
+      int buffer_size_subscription = -1;
     };
 
-    struct Voice : voices::VoiceBase<Voice, Pre> {
-      std::array<gam::Osc<>, 4> pipes;
-      gam::Osc<> percussion;
-      gam::Decay<> perc_env;
+    /// The tables of the voices, shared by all of them
+    ///
+    /// Built at compile time, so they live in read-only memory, and creating the engine builds
+    /// nothing.
+    struct Wavetables {
+      std::array<Wavetable, 3> pipes;
+      Wavetable percussion;
+    };
 
+    struct Voice : voices::VoiceBase<Voice, Pre> {
       Voice(Pre&) noexcept;
 
-      float operator()() noexcept;
+      void process(gsl::span<float> output) noexcept;
 
       void on_note_on() noexcept;
+
+    private:
+      const Wavetables& tables;
+      int lane;
     };
 
+    /// The Leslie: a crossover, with the amplitude of each band modulated by its own rotor
     struct Post : voices::PostBase<Post, Voice> {
-      gam::Biquad<> lpf;
-      gam::Biquad<> hpf;
+      /// The low band in lane 0, and the high band in lane 1
+      util::dsp::BiquadBank crossover;
+      /// Phase of the low and the high rotor, in cycles
+      std::array<float, 2> rotor_phases = {0.5f, 0.5f};
 
       Post(Pre&) noexcept;
 
-      float operator()(float) noexcept;
+      /// The rotors are evaluated every {@ref rotor_chunk} frames, and interpolated in between
+      void process(gsl::span<float>) noexcept;
+
+    private:
+      static constexpr int rotor_chunk = 32;
+
+      /// The gain of each band at the current rotor phases
+      util::simd::float4 rotor_gains() const noexcept;
     };
 
-    voices::VoiceManager<Post, 6> voice_mgr_;
+    voices::VoiceManager<Post, voices::max_voices> voice_mgr_;
   };
 
 } // namespace otto::engines
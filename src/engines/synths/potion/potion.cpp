@@ -92,37 +92,51 @@ namespace otto::engines {
 
   void PotionSynth::load_wavetable(int wt_number, std::string filename)
   {
+    // Always a fresh table, as the voices may be playing the old one
+    auto table = std::make_shared<gam::Array<float>>();
     AudioFile<float> aux;
     bool loaded = aux.load(Application::current().data_dir / "wavetables" / filename);
-    int num_samples = 1;
     if (loaded) {
-      props.wavetables[wt_number].resize(aux.getNumSamplesPerChannel());
+      table->resize(aux.getNumSamplesPerChannel());
       props.samplerates[wt_number] = aux.getSampleRate();
-      util::copy(aux.samples[0], props.wavetables[wt_number].elems());
-      num_samples = aux.getNumSamplesPerChannel();
+      util::copy(aux.samples[0], table->elems());
     } else {
-      props.wavetables[wt_number].resize(1);
+      table->resize(1);
       props.samplerates[wt_number] = 1;
-      props.wavetables[wt_number][0] = 0;
+      (*table)[0] = 0;
     }
-    for (auto&& v : voice_mgr_.voices()) {
-      switch (wt_number) {
+    props.wavetables[wt_number] = table;
+    DLOGI("arraysize: {}", table->size());
+
+    auto* swap = new WavetableSwap{this, wt_number, std::move(table)};
+    ChangeQueue::current().defer({swap, &swap_wavetable});
+  }
+
+  void PotionSynth::swap_wavetable(void* target) noexcept
+  {
+    std::unique_ptr<WavetableSwap> swap(static_cast<WavetableSwap*>(target));
+    auto& self = *swap->self;
+    auto& table = self.voice_wavetables_[swap->index];
+    // The old table is released with `swap`, once the voices no longer play it
+    std::swap(table, swap->table);
+    int num_samples = table->size();
+    for (auto&& v : self.voice_mgr_.voices()) {
+      switch (swap->index) {
       case 0:
-        v.lfo_osc.waves[0].buffer(props.wavetables[0], num_samples, 1);
+        v.lfo_osc.waves[0].buffer(*table, num_samples, 1);
         break;
       case 1:
-        v.lfo_osc.waves[1].buffer(props.wavetables[1], num_samples, 1);
+        v.lfo_osc.waves[1].buffer(*table, num_samples, 1);
         break;
       case 2:
-        v.curve_osc.waves[0].buffer(props.wavetables[2], num_samples, 1);
+        v.curve_osc.waves[0].buffer(*table, num_samples, 1);
         break;
       case 3:
-        v.curve_osc.waves[1].buffer(props.wavetables[3], num_samples, 1);
+        v.curve_osc.waves[1].buffer(*table, num_samples, 1);
         break;
       default: break;
       }
     }
-    DLOGI("arraysize: {}", props.wavetables[wt_number].size());
   }
 
   PotionSynth::Pre::Pre(Props& props) noexcept : PreBase(props) {}
@@ -410,8 +424,9 @@ namespace otto::engines {
 
     ctx.beginPath();
     ctx.moveTo(start.x, start.y);
-    float * val = engine.props.wavetables[wt].begin();
-    int step = engine.props.wavetables[wt].size() / steps;
+    auto& table = *engine.props.wavetables[wt];
+    float * val = table.begin();
+    int step = table.size() / steps;
     //Draw only some of the values. Number of samples must be smaller
     //than number of steps.
     for (int i = 0; i < steps - 1; i++) {
@@ -420,7 +435,7 @@ namespace otto::engines {
       ctx.lineTo(start.x, start.y - (*val) * scale.h);
     }
     start.x += scale.w;
-    val = engine.props.wavetables[wt].end() - 1;
+    val = table.end() - 1;
     ctx.lineTo(start.x, start.y - (*val) * scale.h);
     ctx.stroke(cl);
   }
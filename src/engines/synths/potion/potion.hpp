@@ -1,5 +1,7 @@
 #pragma once
 
+#include <memory>
+
 #include "core/engine/engine.hpp"
 
 #include "core/voices/voice_manager.hpp"
@@ -56,7 +58,8 @@ namespace otto::engines {
       CurveOscProps curve_osc;
       LFOOscProps lfo_osc;
 
-      std::array<gam::Array<float>, 4> wavetables;
+      /// The loaded tables, for the screen. Only touched on the UI thread
+      std::array<std::shared_ptr<gam::Array<float>>, 4> wavetables;
       std::array<float, 4> samplerates;
       std::vector<std::string> filenames;
       std::array<std::vector<std::string>::iterator, 4> file_it = {
@@ -86,8 +89,21 @@ namespace otto::engines {
     DECL_REFLECTION(PotionSynth, props, ("voice_manager", &PotionSynth::voice_mgr_));
 
   private:
+    /// Load a table on the calling thread, and swap it into the voices on the audio thread
     void load_wavetable(int, std::string);
 
+    /// A loaded table on its way to the audio thread
+    struct WavetableSwap {
+      PotionSynth* self;
+      int index;
+      std::shared_ptr<gam::Array<float>> table;
+    };
+
+    static void swap_wavetable(void* swap) noexcept;
+
+    /// The tables the voices play. Only touched on the audio thread
+    std::array<std::shared_ptr<gam::Array<float>>, 4> voice_wavetables_;
+
     struct Voice;
 
     struct Pre : voices::PreBase<Pre, Props> {
@@ -116,7 +132,7 @@ namespace otto::engines {
       float operator()(float) noexcept;
     };
 
-    voices::VoiceManager<Post, 6> voice_mgr_;
+    voices::VoiceManager<Post, voices::max_voices> voice_mgr_;
     friend struct PotionSynthScreen;
   };
 } // namespace otto::engines
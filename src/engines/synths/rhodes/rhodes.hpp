@@ -75,6 +75,6 @@ namespace otto::engines {
       float operator()(float) noexcept;
     };
 
-    voices::VoiceManager<Post, 6> voice_mgr_;
+    voices::VoiceManager<Post, voices::max_voices> voice_mgr_;
   };
 } // namespace otto::engines
@@ -2,12 +2,24 @@
 
 #include <Gamma/Domain.h>
 
+#include "core/props/change_queue.hpp"
+#include "services/engine_manager.hpp"
+#include "services/log_manager.hpp"
+#include "util/timer.hpp"
+
 namespace otto::services {
 
   AudioManager::AudioManager()
   {
     events.pre_init.fire();
     core::midi::generateFreqTable(440);
+    // Processing stops when the application stops running. Apply whatever is left before the
+    // engines are destroyed.
+    Application::current().events.pre_exit.subscribe([this] {
+      wait_one();
+      core::props::ChangeQueue::current().disable();
+      log_stats();
+    });
   }
 
   core::audio::AudioBufferPool& AudioManager::buffer_pool() noexcept
@@ -15,6 +27,16 @@ namespace otto::services {
     return _buffer_pool;
   }
 
+  core::audio::WorkerPool& AudioManager::worker_pool() noexcept
+  {
+    return _worker_pool;
+  }
+
+  core::audio::LoadGovernor& AudioManager::load_governor() noexcept
+  {
+    return _load_governor;
+  }
+
   void AudioManager::start() noexcept
   {
     _running = true;
@@ -34,7 +56,19 @@ namespace otto::services {
 
   void AudioManager::send_midi_event(core::midi::AnyMidiEvent evt) noexcept
   {
-    midi_bufs.outer().emplace_back(std::move(evt));
+    if (!_midi_queue.try_push(std::move(evt))) {
+      _midi_dropped++;
+    }
+  }
+
+  core::midi::MidiEventBuffer& AudioManager::collect_midi_events() noexcept
+  {
+    _midi_buf.clear();
+    _midi_queue.consume([this](core::midi::AnyMidiEvent&& evt) { _midi_buf.push_back(evt); },
+                        core::midi::MidiEventBuffer::capacity);
+    int dropped = _midi_dropped.exchange(0);
+    if (dropped > 0) RT_LOGW("Dropped {} midi events", dropped);
+    return _midi_buf;
   }
 
   float AudioManager::cpu_time() noexcept
@@ -44,4 +78,44 @@ namespace otto::services {
     return res;
   }
 
+  float AudioManager::record_block(std::chrono::nanoseconds time, int nframes) noexcept
+  {
+    float us = std::chrono::duration<float, std::micro>(time).count();
+    float load = us / (1e6f / samplerate() * nframes);
+    _block_times.record(us);
+    _cpu_time.add(load);
+    return load;
+  }
+
+  const util::LatencyHistogram& AudioManager::block_times() const noexcept
+  {
+    return _block_times;
+  }
+
+  int AudioManager::xruns() const noexcept
+  {
+    return _xruns;
+  }
+
+  void AudioManager::log_stats() const
+  {
+    auto log_summary = [](const std::string& name, const util::LatencyHistogram& hist) {
+      auto s = hist.summary();
+      if (s.count == 0) return;
+      LOGI("{:<16} p50 {:7.1f}us  p99 {:7.1f}us  max {:7.1f}us  ({} blocks)", name, s.p50, s.p99,
+           s.max, s.count);
+    };
+    float period = 1e6f / samplerate() * buffer_size();
+    LOGI("Audio statistics, with a period of {:.1f}us and {} xruns:", period, xruns());
+    log_summary("Total", _block_times);
+    // Tests may run without an engine manager
+    if (auto& engines = Application::current().engine_manager._storage) {
+      auto& graph = engines->routing_graph();
+      for (int node = 0; node < graph.node_count(); node++) {
+        log_summary(graph.node_name(node), graph.node_times(node));
+      }
+    }
+    util::timer::log_summary();
+  }
+
 } // namespace otto::services
@@ -1,12 +1,16 @@
 #pragma once
 
+#include <chrono>
 #include <memory>
 
+#include "core/audio/load_governor.hpp"
 #include "core/audio/processor.hpp"
+#include "core/audio/worker_pool.hpp"
 #include "core/service.hpp"
 #include "services/debug_ui.hpp"
 #include "util/event.hpp"
-#include "util/locked.hpp"
+#include "util/histogram.hpp"
+#include "util/lockfree_queue.hpp"
 
 #include "services/application.hpp"
 
@@ -21,13 +25,26 @@ namespace otto::services {
     /// AudioBufferPool::set_buffer_size as soon as possible
     AudioManager();
 
-    /// Use this to get audio buffers. There are currently a maximum of 4 avaliable, so make sure to
-    /// release them when you're done with them!
+    /// Use this to get audio buffers. The pool is sized for the routing graph when it is compiled,
+    /// so make sure to release them when you're done with them!
     core::audio::AudioBufferPool& buffer_pool() noexcept;
 
+    /// Realtime threads that run independent parts of the engine graph in parallel.
+    ///
+    /// Only use it from the audio thread. When it is disabled, everything runs serially.
+    core::audio::WorkerPool& worker_pool() noexcept;
+
+    /// Decides how much work the engines should skip, to keep up with the audio driver.
+    ///
+    /// Drivers that run in realtime report the load of each block to it.
+    core::audio::LoadGovernor& load_governor() noexcept;
+
     /// Send a midi event into the system.
     ///
     /// The `core::midi` namespace has some nice utils for constructing events.
+    ///
+    /// Safe to call from any thread, and never blocks. If the queue is full, the event is dropped,
+    /// and a warning is logged from the audio thread.
     void send_midi_event(core::midi::AnyMidiEvent) noexcept;
 
     /// Get the samplerate
@@ -44,7 +61,7 @@ namespace otto::services {
     unsigned buffer_number() const noexcept { return _buffer_number; }
 
     /// Wait at least until the current process call is done
-    void wait_one() const noexcept;
+    virtual void wait_one() const noexcept;
 
     /// Start audio processing
     ///
@@ -59,6 +76,20 @@ namespace otto::services {
     /// The amount of cpu time spent on average since the last call to this function
     float cpu_time() noexcept;
 
+    /// The time spent in each process call, in microseconds
+    ///
+    /// Unlike {@ref cpu_time}, this keeps the tail, which is what causes dropouts.
+    const util::LatencyHistogram& block_times() const noexcept;
+
+    /// The number of over- and underruns reported by the audio driver
+    int xruns() const noexcept;
+
+    /// Log the block times and xruns, the processing time of each routing node, and the
+    /// scoped timers, if they are enabled
+    ///
+    /// Called when the application exits.
+    void log_stats() const;
+
     /// Get the current instance of this service
     /// 
     /// Alias to `Application::current().audio_manager`
@@ -68,16 +99,41 @@ namespace otto::services {
 
     struct Events {
       util::Event<> pre_init;
+      /// Fired by the driver with the new buffer size, before it starts processing at that size.
+      ///
+      /// Handlers run on the thread that configures the driver, while the audio thread is not
+      /// running, so they may allocate.
+      util::Event<int> buffer_size_change;
     } events;
 
   protected:
-    util::double_buffered<core::midi::shared_vector<core::midi::AnyMidiEvent>> midi_bufs = {{}, {}};
+    /// Move the queued midi events into the buffer for the next block, and return it.
+    ///
+    /// Call this once per process call, from the audio thread. Events that do not fit in the
+    /// block buffer stay queued for the next block.
+    core::midi::MidiEventBuffer& collect_midi_events() noexcept;
+
+    /// Record the time it took to process a block of `nframes`. Call this from the audio thread.
+    ///
+    /// @return the load of the block, the processing time divided by the period
+    float record_block(std::chrono::nanoseconds time, int nframes) noexcept;
+
+    /// Incoming midi events, from any number of threads
+    util::mpsc_queue<core::midi::AnyMidiEvent, 1024> _midi_queue;
+    /// The events for the block being processed. Only touched by the audio thread.
+    core::midi::MidiEventBuffer _midi_buf;
+    /// Number of events dropped by {@ref send_midi_event} because the queue was full
+    std::atomic_int _midi_dropped = 0;
     std::atomic_int _samplerate = 48000;
     std::atomic_uint _buffer_size = 256;
     std::atomic_uint _buffer_number = 0;
     util::audio::Graph _cpu_time;
+    util::LatencyHistogram _block_times;
+    std::atomic_int _xruns = 0;
   private:
     core::audio::AudioBufferPool _buffer_pool{1};
+    core::audio::WorkerPool _worker_pool;
+    core::audio::LoadGovernor _load_governor;
     std::atomic_bool _running{false};
   };
 
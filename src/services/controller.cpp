@@ -3,26 +3,32 @@
 #include "util/iterator.hpp"
 #include "util/utility.hpp"
 
+#include "services/log_manager.hpp"
 #include "services/ui_manager.hpp"
 
 namespace otto::services {
 
   using Event = Controller::Event;
-  using EventBag = Controller::EventBag;
 
   void Controller::keypress(Key key)
   {
-    events.outer().push_back(KeyPressEvent{key});
+    if (!events.try_push(KeyPressEvent{key})) {
+      LOGW("Controller event queue full, dropping event");
+    }
   }
 
   void Controller::encoder(EncoderEvent ev)
   {
-    events.outer().push_back(ev);
+    if (!events.try_push(ev)) {
+      LOGW("Controller event queue full, dropping event");
+    }
   }
 
   void Controller::keyrelease(Key key)
   {
-    events.outer().push_back(KeyReleaseEvent{key});
+    if (!events.try_push(KeyReleaseEvent{key})) {
+      LOGW("Controller event queue full, dropping event");
+    }
   }
 
   bool Controller::is_pressed(Key k) noexcept
@@ -50,8 +56,7 @@ namespace otto::services {
 
   void Controller::flush_events()
   {
-    events.swap();
-    for (auto& event : events.inner()) {
+    events.consume([this](Event&& event) {
       util::match(event,
                   [this](KeyPressEvent& ev) {
                     keys[ev.key._to_index()] = true;
@@ -66,7 +71,7 @@ namespace otto::services {
                   [](EncoderEvent& ev) {
                     UIManager::current().current_screen().encoder(ev);
                   });
-    }
+    });
   }
 
 
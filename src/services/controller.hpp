@@ -6,7 +6,7 @@
 #include <foonathan/array/flat_map.hpp>
 #include <vector>
 
-#include "util/locked.hpp"
+#include "util/lockfree_queue.hpp"
 #include "util/variant.hpp"
 
 #include "core/service.hpp"
@@ -189,7 +189,11 @@ namespace otto::services {
     using KeyHandler = std::function<void(Key k)>;
 
     using Event = util::variant<EncoderEvent, KeyPressEvent, KeyReleaseEvent>;
-    using EventBag = std::vector<Event>;
+    /// Events from the input threads, waiting for the next {@ref flush_events()}
+    ///
+    /// Multiple producers, as a board can have several input sources, like the GLFW window and
+    /// the serial controller on the desktop board.
+    using EventQueue = util::mpsc_queue<Event, 256>;
 
     static std::unique_ptr<Controller> make_dummy();
     static Controller& current() noexcept {
@@ -244,7 +248,7 @@ namespace otto::services {
 
     foonathan::array::flat_map<Key, std::pair<KeyHandler, KeyHandler>> key_handlers;
     std::array<bool, Key::_size()> keys;
-    util::double_buffered<EventBag> events;
+    EventQueue events;
   };
 } // namespace otto::services
 
@@ -1,6 +1,8 @@
 #include "engine_manager.hpp"
+
 #include "core/engine/engine_dispatcher.hpp"
 #include "core/engine/engine_dispatcher.inl"
+#include "core/engine/routing_graph.hpp"
 
 #include <engines/synths/goss/goss.hpp>
 #include <engines/synths/potion/potion.hpp>
@@ -16,6 +18,8 @@
 #include "engines/synths/rhodes/rhodes.hpp"
 
 #include "services/application.hpp"
+#include "services/audio_manager.hpp"
+#include "util/timer.hpp"
 
 #include "core/ui/vector_graphics.hpp"
 
@@ -30,9 +34,12 @@ namespace otto::services {
     void start() override;
     audio::ProcessData<2> process(audio::ProcessData<1> external_in) override;
     IEngine* by_name(const std::string& name) noexcept override;
+    IEngine* select(const std::string& slot, const std::string& engine) override;
+    const RoutingGraph& routing_graph() const noexcept override;
 
   private:
     std::unordered_map<std::string, std::function<IEngine*()>> engineGetters;
+    std::unordered_map<std::string, IEngineDispatcher*> dispatchers;
 
     using EffectsDispatcher = EngineDispatcher< //
       EngineType::effect,
@@ -58,6 +65,8 @@ namespace otto::services {
     engines::Sends line_in_send;
     engines::Master master;
     // engines::Sequencer sequencer;
+
+    RoutingGraph graph;
   };
 
   std::unique_ptr<EngineManager> EngineManager::create_default()
@@ -76,6 +85,11 @@ namespace otto::services {
     engineGetters.try_emplace("Effect2", [&]() { return &effect2.current(); });
     engineGetters.try_emplace("Arpeggiator", [&]() { return &arpeggiator.current(); });
 
+    dispatchers.try_emplace("Synth", &synth);
+    dispatchers.try_emplace("Effect1", &effect1);
+    dispatchers.try_emplace("Effect2", &effect2);
+    dispatchers.try_emplace("Arpeggiator", &arpeggiator);
+
     auto reg_ss = [&](auto se, auto&& f) { return ui_manager.register_screen_selector(se, f); };
 
     // reg_ss(ScreenEnum::sends, );
@@ -188,6 +202,44 @@ namespace otto::services {
     };
 
     state_manager.attach("Engines", load, save);
+
+    // The line in is routed like the synth, but only heard when it is turned up
+    line_in_send.props.dry = 0;
+
+    auto line_in = graph.add_input("Line in");
+    auto synth_node = graph.add_node(
+      "Synth", 0, 1,
+      [&](auto& in, auto& out, auto data) {
+        TIME_SCOPE(synth->name().c_str());
+        // The synth has no input, but some synths render into the buffer they are given
+        auto& pool = Application::current().audio_manager->buffer_pool();
+        out.audio[0] = synth->process(data.redirect(pool.allocate_clear())).audio;
+      },
+      voices::IVoiceManager::scratch_buffers + 1);
+    auto fx1_node = graph.add_node("Effect1", 1, 2, [&](auto& in, auto& out, auto data) {
+      TIME_SCOPE(effect1->name().c_str());
+      out.audio = effect1->process(data.redirect(in.audio[0])).audio;
+    });
+    auto fx2_node = graph.add_node("Effect2", 1, 2, [&](auto& in, auto& out, auto data) {
+      TIME_SCOPE(effect2->name().c_str());
+      out.audio = effect2->process(data.redirect(in.audio[0])).audio;
+    });
+    auto master_node = graph.add_node("Master", 2, 2, [&](auto& in, auto& out, auto data) {
+      TIME_SCOPE("Master");
+      out.audio = master.process(data.redirect(in.audio)).audio;
+    });
+
+    auto connect_sends = [&](RoutingGraph::NodeId node, engines::Sends& send) {
+      graph.connect(node, fx1_node, &send.props.to_FX1);
+      graph.connect(node, fx2_node, &send.props.to_FX2);
+      graph.connect(node, master_node, &send.props.dry, &send.props.dry_pan);
+    };
+    connect_sends(synth_node, synth_send);
+    connect_sends(line_in, line_in_send);
+    graph.connect(fx1_node, master_node);
+    graph.connect(fx2_node, master_node);
+    graph.output(master_node);
+    graph.compile();
   }
 
   void DefaultEngineManager::start()
@@ -201,37 +253,12 @@ namespace otto::services {
   audio::ProcessData<2> DefaultEngineManager::process(audio::ProcessData<1> external_in)
   { // Main processor function
     auto midi_in = external_in.midi_only();
-    auto arp_out = arpeggiator->process(midi_in);
-    auto synth_out = synth->process({external_in.audio, arp_out.midi, external_in.nframes});
+    auto arp_out = [&] {
+      TIME_SCOPE(arpeggiator->name().c_str());
+      return arpeggiator->process(midi_in);
+    }();
     // auto seq_out = sequencer.process(midi_in);
-    auto fx1_bus = Application::current().audio_manager->buffer_pool().allocate();
-    auto fx2_bus = Application::current().audio_manager->buffer_pool().allocate();
-    for (auto&& [snth, fx1, fx2] : util::zip(synth_out.audio, fx1_bus, fx2_bus)) {
-      fx1 = snth * synth_send.props.to_FX1;
-      fx2 = snth * synth_send.props.to_FX2;
-    }
-    auto fx1_out = effect1->process(audio::ProcessData<1>(fx1_bus));
-    auto fx2_out = effect2->process(audio::ProcessData<1>(fx2_bus));
-    for (auto&& [snth, fx1L, fx1R, fx2L, fx2R] :
-         util::zip(synth_out.audio, fx1_out.audio[0], fx1_out.audio[1], fx2_out.audio[0],
-                   fx2_out.audio[1])) {
-      fx1L += fx2L + snth * synth_send.props.dry * (1 - synth_send.props.dry_pan);
-      fx1R += fx2R + snth * synth_send.props.dry * (1 + synth_send.props.dry_pan);
-    }
-    synth_out.audio.release();
-    fx2_out.audio[0].release();
-    fx2_out.audio[1].release();
-    fx1_bus.release();
-    fx2_bus.release();
-    return master.process(std::move(fx1_out));
-    /*
-    auto temp = Application::current().audio_manager->buffer_pool().allocate_multi_clear<2>();
-    for (auto&& [in, tmp] : util::zip(seq_out, temp)) {
-    std::get<0>(tmp) += std::get<0>(in);
-        std::get<1>(tmp) += std::get<0>(in);
-        }
-    return master.process({std::move(temp),external_in.midi,external_in.nframes});
-    */
+    return graph.process({external_in.audio, arp_out.midi, external_in.nframes});
   }
 
   IEngine* DefaultEngineManager::by_name(const std::string& name) noexcept
@@ -242,4 +269,17 @@ namespace otto::services {
     return getter->second();
   }
 
+  IEngine* DefaultEngineManager::select(const std::string& slot, const std::string& engine)
+  {
+    auto dispatcher = dispatchers.find(slot);
+    if (dispatcher == dispatchers.end()) return nullptr;
+
+    return &dispatcher->second->select(engine);
+  }
+
+  const RoutingGraph& DefaultEngineManager::routing_graph() const noexcept
+  {
+    return graph;
+  }
+
 } // namespace otto::services
@@ -4,6 +4,7 @@
 
 #include "core/service.hpp"
 #include "core/engine/engine.hpp"
+#include "core/engine/routing_graph.hpp"
 
 #include "core/audio/processor.hpp"
 
@@ -52,6 +53,15 @@ namespace otto::services {
     /// \returns `nullptr` if no such engine was found
     virtual core::engine::IEngine* by_name(const std::string& name) noexcept = 0;
 
+    /// The routing between the engines
+    virtual const core::engine::RoutingGraph& routing_graph() const noexcept = 0;
+
+    /// Select the engine called `engine` in the slot `slot`, e.g. `select("Synth", "Goss")`
+    ///
+    /// \returns the newly selected engine, or `nullptr` if there is no such slot
+    /// \throws util::exception if the slot has no engine called `engine`
+    virtual core::engine::IEngine* select(const std::string& slot, const std::string& engine) = 0;
+
     /// For now, this is the way to get the default EngineManager implementation
     /// 
     /// This is very likely to be changed in the future
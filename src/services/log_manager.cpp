@@ -1,6 +1,8 @@
 #include "log_manager.hpp"
 #include "services/application.hpp"
 
+#include <chrono>
+
 #define LOGURU_IMPLEMENTATION 1
 #include <loguru.hpp>
 
@@ -26,6 +28,30 @@ namespace otto::services {
     });
 
     LOGI("LOGGING NOW");
+
+    _rt_thread = std::thread([this] {
+      loguru::set_thread_name("realtime log");
+      while (_should_run) {
+        flush_rt_messages();
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      }
+    });
+  }
+
+  LogManager::~LogManager()
+  {
+    _should_run = false;
+    _rt_thread.join();
+    flush_rt_messages();
+  }
+
+  void LogManager::flush_rt_messages()
+  {
+    _rt_queue.consume([](RtMessage&& msg) {
+      loguru::log(msg.verbosity, msg.file, msg.line, "{}", msg.text.data());
+    });
+    int dropped = _rt_dropped.exchange(0);
+    LOGW_IF(dropped > 0, "Dropped {} realtime log messages", dropped);
   }
 
   void LogManager::set_thread_name(const std::string& name)
@@ -1,11 +1,17 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <thread>
+
 #include "util/filesystem.hpp"
+#include "util/lockfree_queue.hpp"
 
 #include "core/service.hpp"
 
 #define LOGURU_USE_FMTLIB 1
 #include <debug_assert.hpp>
+#include <fmt/format.h>
 #include <loguru.hpp>
 
 #include "services/application.hpp"
@@ -19,10 +25,63 @@ namespace otto::services {
                bool enable_console = true,
                const char* logFilePath = nullptr);
 
+    /// Writes the remaining realtime messages, and stops the thread that writes them
+    ~LogManager();
+
     /// Set how the current thread appears in the log
     void set_thread_name(const std::string& name);
+
+    /// Log from the audio thread, or any other thread that must not block or allocate
+    ///
+    /// The message is formatted into a fixed size buffer, and queued. A background thread of the
+    /// log manager writes it to the log a little later. Long messages are truncated, and if the
+    /// queue is full, the message is dropped, and the number of dropped messages is logged
+    /// instead.
+    ///
+    /// Use the `RT_LOG*` macros rather than calling this directly.
+    template<typename... Args>
+    static void rt_log(loguru::Verbosity verbosity,
+                       const char* file,
+                       unsigned line,
+                       const char* format,
+                       const Args&... args) noexcept;
+
+  private:
+    struct RtMessage {
+      loguru::Verbosity verbosity;
+      const char* file;
+      unsigned line;
+      std::array<char, 128> text;
+    };
+
+    /// Write the queued realtime messages to the log
+    static void flush_rt_messages();
+
+    inline static util::mpsc_queue<RtMessage, 128> _rt_queue;
+    inline static std::atomic_int _rt_dropped = 0;
+
+    std::atomic_bool _should_run = true;
+    std::thread _rt_thread;
   };
 
+  template<typename... Args>
+  void LogManager::rt_log(loguru::Verbosity verbosity,
+                          const char* file,
+                          unsigned line,
+                          const char* format,
+                          const Args&... args) noexcept
+  {
+    if (verbosity > loguru::current_verbosity_cutoff()) return;
+    RtMessage msg{verbosity, file, line, {}};
+    try {
+      auto res = fmt::format_to_n(msg.text.data(), msg.text.size() - 1, format, args...);
+      *res.out = '\0';
+    } catch (...) {
+      return;
+    }
+    if (!_rt_queue.try_push(msg)) _rt_dropped++;
+  }
+
 } // namespace otto::services
 
 /// Shorthand to the loguru macro LOG_F(INFO, ...)
@@ -73,6 +132,18 @@ namespace otto::services {
 /// Shorthand to the loguru macro DLOG_IF_F(FATAL, ...)
 #define DLOGF_IF(...) DLOG_IF_F(FATAL, __VA_ARGS__)
 
+/// Log INFO from a realtime thread. See LogManager::rt_log
+#define RT_LOGI(...)                                                                               \
+  ::otto::services::LogManager::rt_log(loguru::Verbosity_INFO, __FILE__, __LINE__, __VA_ARGS__)
+
+/// Log WARNING from a realtime thread. See LogManager::rt_log
+#define RT_LOGW(...)                                                                               \
+  ::otto::services::LogManager::rt_log(loguru::Verbosity_WARNING, __FILE__, __LINE__, __VA_ARGS__)
+
+/// Log ERROR from a realtime thread. See LogManager::rt_log
+#define RT_LOGE(...)                                                                               \
+  ::otto::services::LogManager::rt_log(loguru::Verbosity_ERROR, __FILE__, __LINE__, __VA_ARGS__)
+
 /// Shorthand to the loguru macro LOG_SCOPE_F(INFO, ...)
 #define LOGI_SCOPE(...) LOG_SCOPE_F(INFO, __VA_ARGS__)
 
@@ -96,9 +96,21 @@ namespace otto::services {
       ctx.beginPath();
       ctx.fillStyle(vg::Colours::White);
       ctx.font(vg::Fonts::Norm, 12);
-      std::string cpu_time =
-        fmt::format("{}%", int(100 * Application::current().audio_manager->cpu_time()));
+      auto& audio_manager = *Application::current().audio_manager;
+      std::string cpu_time = fmt::format("{}%", int(100 * audio_manager.cpu_time()));
       ctx.fillText(cpu_time, {290, 230});
+      if (auto blocks = audio_manager.block_times().summary(); blocks.count > 0) {
+        // Red when one in a hundred blocks takes longer than the driver gives us
+        float period_ms = 1000.f * audio_manager.buffer_size() / audio_manager.samplerate();
+        if (blocks.p99 / 1000 > period_ms) ctx.fillStyle(vg::Colours::Red);
+        ctx.fillText(fmt::format("p99 {:.1f} max {:.1f}ms", blocks.p99 / 1000, blocks.max / 1000),
+                     {100, 230});
+        ctx.fillStyle(vg::Colours::White);
+      }
+      if (int xruns = audio_manager.xruns(); xruns > 0) {
+        ctx.fillStyle(vg::Colours::Red);
+        ctx.fillText(fmt::format("{} xruns", xruns), {230, 230});
+      }
     });
 
     Controller::current().flush_leds();
@@ -2,8 +2,11 @@
 
 // namespace otto::util::audio
 
+#include <cmath>
+
 #include "util/dyn-array.hpp"
 #include "util/iterator.hpp"
+#include "util/simd.hpp"
 
 namespace otto::util::audio {
 
@@ -70,6 +73,172 @@ namespace otto::util::audio {
     }
   };
 
+  // -- Block kernels -- //
+  //
+  // Vectorized with util::simd, four samples at a time, with a scalar loop for the last few.
+  // The buffers need no particular alignment, and `n` can be any length. The destination comes
+  // first, and may be the same buffer as the source.
+  //
+  // Ramps go linearly from `from` to `to`, and reach `to` on the last sample, like
+  // SmoothedValue::next() does.
+
+  /// `dst = src * g`
+  inline void gain(float* dst, const float* src, int n, float g) noexcept
+  {
+    using simd::float4;
+    int i = 0;
+    for (float4 vg = g; i + simd::width <= n; i += simd::width) {
+      (float4::loadu(src + i) * vg).storeu(dst + i);
+    }
+    for (; i < n; i++) dst[i] = src[i] * g;
+  }
+
+  /// `data *= g`
+  inline void gain(float* data, int n, float g) noexcept
+  {
+    gain(data, data, n, g);
+  }
+
+  /// `dst = src * g`, with `g` ramping from `from` to `to`
+  inline void gain_ramp(float* dst, const float* src, int n, float from, float to) noexcept
+  {
+    using simd::float4;
+    if (from == to) return gain(dst, src, n, to);
+    const float step = (to - from) / n;
+    int i = 0;
+    float4 vg = {from + step, from + 2 * step, from + 3 * step, from + 4 * step};
+    for (float4 vstep = 4 * step; i + simd::width <= n; i += simd::width, vg += vstep) {
+      (float4::loadu(src + i) * vg).storeu(dst + i);
+    }
+    for (; i < n; i++) dst[i] = src[i] * (from + step * (i + 1));
+  }
+
+  /// `data *= g`, with `g` ramping from `from` to `to`
+  inline void gain_ramp(float* data, int n, float from, float to) noexcept
+  {
+    gain_ramp(data, data, n, from, to);
+  }
+
+  /// `dst += src * g`
+  inline void mix_add(float* dst, const float* src, int n, float g = 1.f) noexcept
+  {
+    using simd::float4;
+    int i = 0;
+    for (float4 vg = g; i + simd::width <= n; i += simd::width) {
+      fma(float4::loadu(src + i), vg, float4::loadu(dst + i)).storeu(dst + i);
+    }
+    for (; i < n; i++) dst[i] += src[i] * g;
+  }
+
+  /// `dst += src * g`, with `g` ramping from `from` to `to`
+  inline void mix_add_ramp(float* dst, const float* src, int n, float from, float to) noexcept
+  {
+    using simd::float4;
+    if (from == to) return mix_add(dst, src, n, to);
+    const float step = (to - from) / n;
+    int i = 0;
+    float4 vg = {from + step, from + 2 * step, from + 3 * step, from + 4 * step};
+    for (float4 vstep = 4 * step; i + simd::width <= n; i += simd::width, vg += vstep) {
+      fma(float4::loadu(src + i), vg, float4::loadu(dst + i)).storeu(dst + i);
+    }
+    for (; i < n; i++) dst[i] += src[i] * (from + step * (i + 1));
+  }
+
+  /// Pan the mono `src` into the stereo `l` and `r`, adding to them
+  ///
+  /// `pan` is in `[-1, 1]`. The left channel gets `g * (1 - pan)`, and the right `g * (1 + pan)`.
+  inline void pan_mix(float* l, float* r, const float* src, int n, float g, float pan) noexcept
+  {
+    using simd::float4;
+    const float gl = g * (1 - pan);
+    const float gr = g * (1 + pan);
+    int i = 0;
+    for (float4 vl = gl, vr = gr; i + simd::width <= n; i += simd::width) {
+      float4 s = float4::loadu(src + i);
+      fma(s, vl, float4::loadu(l + i)).storeu(l + i);
+      fma(s, vr, float4::loadu(r + i)).storeu(r + i);
+    }
+    for (; i < n; i++) {
+      l[i] += src[i] * gl;
+      r[i] += src[i] * gr;
+    }
+  }
+
+  /// Interleave the planar `l` and `r` into `out`, which holds `2 * n` samples
+  inline void interleave(float* out, const float* l, const float* r, int n) noexcept
+  {
+    using simd::float4;
+    int i = 0;
+    for (; i + simd::width <= n; i += simd::width) {
+      float4 lo, hi;
+      simd::interleave(float4::loadu(l + i), float4::loadu(r + i), lo, hi);
+      lo.storeu(out + 2 * i);
+      hi.storeu(out + 2 * i + simd::width);
+    }
+    for (; i < n; i++) {
+      out[2 * i] = l[i];
+      out[2 * i + 1] = r[i];
+    }
+  }
+
+  /// Split the interleaved stereo `in`, which holds `2 * n` samples, into `l` and `r`
+  inline void deinterleave(float* l, float* r, const float* in, int n) noexcept
+  {
+    using simd::float4;
+    int i = 0;
+    for (; i + simd::width <= n; i += simd::width) {
+      float4 a, b;
+      simd::deinterleave(float4::loadu(in + 2 * i), float4::loadu(in + 2 * i + simd::width), a, b);
+      a.storeu(l + i);
+      b.storeu(r + i);
+    }
+    for (; i < n; i++) {
+      l[i] = in[2 * i];
+      r[i] = in[2 * i + 1];
+    }
+  }
+
+  /// The largest absolute value in `data`
+  inline float peak(const float* data, int n) noexcept
+  {
+    using simd::float4;
+    int i = 0;
+    float4 vmax = 0.f;
+    for (; i + simd::width <= n; i += simd::width) {
+      vmax = max(vmax, abs(float4::loadu(data + i)));
+    }
+    float res = simd::hmax(vmax);
+    for (; i < n; i++) res = std::fmax(res, std::fabs(data[i]));
+    return res;
+  }
+
+  /// The root mean square of `data`
+  inline float rms(const float* data, int n) noexcept
+  {
+    using simd::float4;
+    if (n <= 0) return 0;
+    int i = 0;
+    float4 vsum = 0.f;
+    for (; i + simd::width <= n; i += simd::width) {
+      float4 x = float4::loadu(data + i);
+      vsum = fma(x, x, vsum);
+    }
+    float res = sum(vsum);
+    for (; i < n; i++) res += data[i] * data[i];
+    return std::sqrt(res / n);
+  }
+
+  /// Clamp every sample in `data` to `[lo, hi]`
+  inline void clamp(float* data, int n, float lo, float hi) noexcept
+  {
+    using simd::float4;
+    int i = 0;
+    for (float4 vlo = lo, vhi = hi; i + simd::width <= n; i += simd::width) {
+      min(max(float4::loadu(data + i), vlo), vhi).storeu(data + i);
+    }
+    for (; i < n; i++) data[i] = std::clamp(data[i], lo, hi);
+  }
+
   /// Envelope follower
   struct EnvelopeFollower {
     const float k = 0.001;
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+
+#include "util/simd.hpp"
+
+namespace otto::util::dsp {
+
+  /// Coefficients of a biquad filter, normalized so `a0` is 1
+  ///
+  /// The designs are from the RBJ audio EQ cookbook, which is also what `gam::Biquad` uses.
+  struct BiquadCoefficients {
+    float b0 = 0;
+    float b1 = 0;
+    float b2 = 0;
+    float a1 = 0;
+    float a2 = 0;
+
+    static BiquadCoefficients lowpass(float freq, float q, float samplerate) noexcept
+    {
+      float w = 2 * M_PI * freq / samplerate;
+      float cosw = std::cos(w);
+      float alpha = std::sin(w) / (2 * q);
+      return normalized((1 - cosw) / 2, 1 - cosw, (1 - cosw) / 2, 1 + alpha, -2 * cosw,
+                        1 - alpha);
+    }
+
+    static BiquadCoefficients highpass(float freq, float q, float samplerate) noexcept
+    {
+      float w = 2 * M_PI * freq / samplerate;
+      float cosw = std::cos(w);
+      float alpha = std::sin(w) / (2 * q);
+      return normalized((1 + cosw) / 2, -(1 + cosw), (1 + cosw) / 2, 1 + alpha, -2 * cosw,
+                        1 - alpha);
+    }
+
+  private:
+    static BiquadCoefficients normalized(float b0,
+                                         float b1,
+                                         float b2,
+                                         float a0,
+                                         float a1,
+                                         float a2) noexcept
+    {
+      return {b0 / a0, b1 / a0, b2 / a0, a1 / a0, a2 / a0};
+    }
+  };
+
+  /// Four biquads filtering the same signal, one per util::simd lane
+  ///
+  /// A single biquad does not vectorize, as every sample depends on the ones before it. Filters
+  /// running side by side on one signal do, like the bands of a crossover. Transposed direct
+  /// form II.
+  struct BiquadBank {
+    /// Set the coefficients of the filter in `lane`. Lanes that are never set output silence.
+    void set(int lane, const BiquadCoefficients& c) noexcept
+    {
+      _coefs[0][lane] = c.b0;
+      _coefs[1][lane] = c.b1;
+      _coefs[2][lane] = c.b2;
+      _coefs[3][lane] = c.a1;
+      _coefs[4][lane] = c.a2;
+      _b0 = simd::float4::load(_coefs[0].data());
+      _b1 = simd::float4::load(_coefs[1].data());
+      _b2 = simd::float4::load(_coefs[2].data());
+      _a1 = simd::float4::load(_coefs[3].data());
+      _a2 = simd::float4::load(_coefs[4].data());
+    }
+
+    /// Filter one sample, and get the output of each filter
+    simd::float4 operator()(float in) noexcept
+    {
+      simd::float4 x = in;
+      simd::float4 y = fma(_b0, x, _s1);
+      _s1 = fma(_b1, x, _s2) - _a1 * y;
+      _s2 = _b2 * x - _a2 * y;
+      return y;
+    }
+
+    void reset() noexcept
+    {
+      _s1 = 0.f;
+      _s2 = 0.f;
+    }
+
+  private:
+    alignas(simd::alignment) std::array<std::array<float, simd::width>, 5> _coefs = {};
+    simd::float4 _b0 = 0.f;
+    simd::float4 _b1 = 0.f;
+    simd::float4 _b2 = 0.f;
+    simd::float4 _a1 = 0.f;
+    simd::float4 _a2 = 0.f;
+    simd::float4 _s1 = 0.f;
+    simd::float4 _s2 = 0.f;
+  };
+
+} // namespace otto::util::dsp
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+
+namespace otto::util::dsp {
+
+  /// Halves the sample rate, with a half-band lowpass to keep what is above the new Nyquist
+  /// frequency from aliasing
+  ///
+  /// Every other coefficient of a half-band FIR is zero, and the center one is 0.5. The filter is
+  /// split into its two polyphase branches: the odd input samples go through the `K` symmetric
+  /// coefficient pairs, and the even ones through a plain delay. Only the output samples that are
+  /// kept are computed, so it costs `K` multiplies per output sample, for `4K - 1` taps.
+  ///
+  /// @tparam K the number of coefficient pairs. The signal is delayed by `2K - 1` input samples.
+  template<int K>
+  struct HalfBandDecimator {
+    /// @param coefs the coefficients next to the center one, going outwards
+    constexpr HalfBandDecimator(const std::array<float, K>& coefs) noexcept : coefs(coefs) {}
+
+    /// Decimate the `2 * n` samples in `in` to `n` samples in `out`, which may be `in`
+    void process(float* out, const float* in, int n) noexcept
+    {
+      for (int i = 0; i < n; i++) {
+        // Both halves of the rings are written, so the newest 2K samples are always contiguous,
+        // starting at `pos`, newest first
+        pos = (pos == 0 ? 2 * K : pos) - 1;
+        evens[pos] = evens[pos + 2 * K] = in[2 * i];
+        odds[pos] = odds[pos + 2 * K] = in[2 * i + 1];
+        const float* o = &odds[pos];
+        float res = 0.5f * evens[pos + K - 1];
+        for (int j = 0; j < K; j++) {
+          res += coefs[j] * (o[K - 1 - j] + o[K + j]);
+        }
+        out[i] = res;
+      }
+    }
+
+    /// Clear the filter history
+    void reset() noexcept
+    {
+      std::fill(evens.begin(), evens.end(), 0.f);
+      std::fill(odds.begin(), odds.end(), 0.f);
+    }
+
+  private:
+    std::array<float, K> coefs;
+    std::array<float, 4 * K> evens = {};
+    std::array<float, 4 * K> odds = {};
+    int pos = 0;
+  };
+
+  /// Decimates by 1, 2 or 4, in half-band stages, for running DSP at a multiple of the sample
+  /// rate to keep it from aliasing
+  ///
+  /// Passes everything up to 0.83 of the output Nyquist frequency (20kHz at 48kHz) within 0.01dB,
+  /// and attenuates what would alias back into that range by 78dB or more. Kaiser windowed sinc
+  /// filters, 63 taps at 2x, and 19 more at 4x.
+  struct Decimator {
+    /// Decimate the `n * factor` samples in `in` to `n` samples in `out`
+    ///
+    /// `in` is used as scratch space. Changing the factor clears the filter history.
+    ///
+    /// @param factor 1, 2 or 4
+    void process(float* out, float* in, int n, int factor) noexcept
+    {
+      if (factor != _factor) {
+        _factor = factor;
+        _last_stage.reset();
+        _first_stage.reset();
+      }
+      switch (factor) {
+        case 4: _first_stage.process(in, in, 2 * n); [[fallthrough]];
+        case 2: _last_stage.process(out, in, n); break;
+        default: std::copy(in, in + n, out);
+      }
+    }
+
+  private:
+    /// From 4x to 2x, where the transition band can be wide
+    HalfBandDecimator<5> _first_stage = {{
+      0.303921731f, -0.0692344524f, 0.0182014775f, -0.00297148073f, 8.27243639e-05f, //
+    }};
+    /// From 2x to the output rate
+    HalfBandDecimator<16> _last_stage = {{
+      0.317072851f,     -0.102442502f,   0.0577240406f,  -0.0374893791f,
+      0.0256376836f,    -0.017804699f,   0.0123155822f,  -0.00837620988f,
+      0.00554364665f,   -0.00353441407f, 0.00214590843f, -0.00122207592f,
+      0.000638106334f,  -0.000293560062f, 0.000109036223f, -2.40152509e-05f, //
+    }};
+    int _factor = 1;
+  };
+
+} // namespace otto::util::dsp
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cmath>
+
+#include "util/simd.hpp"
+
+namespace otto::util::dsp {
+
+  /// `sin(pi * x)` for `x` in `[-1, 1]`
+  ///
+  /// An odd 9th order polynomial with exact zeros at -1, 0 and 1, accurate to about 1e-5.
+  /// Works on both `float` and {@ref util::simd::float4}.
+  template<typename T>
+  T sin_pi(T x) noexcept
+  {
+    T x2 = x * x;
+    T p = T(-0.0636898676f) * x2 + T(0.517491328f);
+    p = p * x2 + T(-2.02477312f);
+    p = p * x2 + T(3.14152114f);
+    return x * (T(1.f) - x2) * p;
+  }
+
+  /// Wrap `x` into `[-1, 1)`
+  template<typename T>
+  T wrap_bipolar(T x) noexcept
+  {
+    using std::floor;
+    return x - T(2.f) * floor((x + T(1.f)) * T(0.5f));
+  }
+
+  /// A phase modulated sine oscillator, rendered a block at a time
+  ///
+  /// The phase runs from -1 to 1 per cycle, like `gam::AccumPhase` with a radius of 1, and the
+  /// modulation is added to it. {@ref process} renders four samples per instruction with
+  /// util::simd. Feedback needs each sample before the next one, so use {@ref next} for that.
+  struct PMSine {
+    void freq(float hz, float samplerate) noexcept
+    {
+      increment = 2 * hz / samplerate;
+    }
+
+    /// The next sample, with `mod` added to the phase
+    float next(float mod = 0) noexcept
+    {
+      float res = sin_pi(wrap_bipolar(phase + mod));
+      phase = wrap_bipolar(phase + increment);
+      return res;
+    }
+
+    /// Render `n` samples into `out`, with `mod[i]` added to the phase of sample `i`
+    ///
+    /// @param mod the phase modulation, or `nullptr` for none
+    void process(float* out, const float* mod, int n) noexcept
+    {
+      using simd::float4;
+      const float4 steps = {0, increment, 2 * increment, 3 * increment};
+      int i = 0;
+      for (; i + simd::width <= n; i += simd::width) {
+        float4 ph = float4(phase) + steps;
+        if (mod) ph += float4::loadu(mod + i);
+        sin_pi(wrap_bipolar(ph)).storeu(out + i);
+        phase = wrap_bipolar(phase + simd::width * increment);
+      }
+      for (; i < n; i++) out[i] = next(mod ? mod[i] : 0);
+    }
+
+    /// In `[-1, 1)`
+    float phase = 0;
+    /// Phase increment per sample, `2 * frequency / samplerate`
+    float increment = 0;
+  };
+
+} // namespace otto::util::dsp
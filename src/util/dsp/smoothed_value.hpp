@@ -0,0 +1,128 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+#include <gsl/span>
+
+namespace otto::util::dsp {
+
+  enum struct SmoothingMode {
+    /// Move towards the target in equal steps, reaching it at the end of the ramp
+    linear,
+    /// Move a fixed fraction of the remaining distance per sample. Reaches -60dB of the
+    /// initial distance at the end of the ramp, and then snaps to the target
+    exponential,
+  };
+
+  /// A value that ramps towards its target, to avoid zipper noise on parameter changes
+  ///
+  /// Cheaper than running a filter per sample: when the value has reached its target, {@ref
+  /// next()} is a single branch, and {@ref apply()} is a constant gain. Call {@ref
+  /// set_target()} once per block, and use either {@ref next()} per sample, or {@ref skip()} to
+  /// get the value at the end of the block and interpolate yourself.
+  struct SmoothedValue {
+    SmoothedValue(float value = 0,
+                  int ramp_frames = 1024,
+                  SmoothingMode mode = SmoothingMode::linear) noexcept
+      : _mode(mode), _value(value), _target(value)
+    {
+      set_ramp_length(ramp_frames);
+    }
+
+    /// Set the length of new ramps, in frames
+    void set_ramp_length(int frames) noexcept
+    {
+      _ramp_frames = std::max(frames, 1);
+      _coeff = 1.f - std::pow(0.001f, 1.f / _ramp_frames);
+    }
+
+    int ramp_length() const noexcept
+    {
+      return _ramp_frames;
+    }
+
+    /// Start ramping towards `target`. Does nothing if it is already the target
+    void set_target(float target) noexcept
+    {
+      if (target == _target) return;
+      _target = target;
+      _remaining = _ramp_frames;
+      _step = (_target - _value) / _ramp_frames;
+    }
+
+    /// Jump to `value` without ramping
+    void reset(float value) noexcept
+    {
+      _value = _target = value;
+      _remaining = 0;
+    }
+
+    float target() const noexcept
+    {
+      return _target;
+    }
+
+    /// The current value
+    float value() const noexcept
+    {
+      return _value;
+    }
+
+    bool is_smoothing() const noexcept
+    {
+      return _remaining > 0;
+    }
+
+    /// Advance one frame, and get the new value
+    float next() noexcept
+    {
+      if (_remaining == 0) return _value;
+      if (--_remaining == 0) {
+        _value = _target;
+      } else if (_mode == SmoothingMode::linear) {
+        _value += _step;
+      } else {
+        _value += (_target - _value) * _coeff;
+      }
+      return _value;
+    }
+
+    /// Advance `nframes` frames, and get the new value
+    float skip(int nframes) noexcept
+    {
+      if (nframes >= _remaining) {
+        reset(_target);
+      } else if (_mode == SmoothingMode::linear) {
+        _remaining -= nframes;
+        _value += _step * nframes;
+      } else {
+        _remaining -= nframes;
+        _value = _target + (_value - _target) * std::pow(1.f - _coeff, float(nframes));
+      }
+      return _value;
+    }
+
+    /// Multiply `buffer` by the value, advancing one frame per sample
+    void apply(gsl::span<float> buffer) noexcept
+    {
+      int i = 0;
+      for (; i < buffer.size() && is_smoothing(); i++) {
+        buffer[i] *= next();
+      }
+      for (; i < buffer.size(); i++) {
+        buffer[i] *= _value;
+      }
+    }
+
+  private:
+    SmoothingMode _mode;
+    float _value;
+    float _target;
+    float _step = 0;
+    float _coeff = 0;
+    int _ramp_frames = 1;
+    int _remaining = 0;
+  };
+
+} // namespace otto::util::dsp
@@ -1,7 +1,8 @@
 #pragma once
 
-#include <vector>
+#include <algorithm>
 #include <functional>
+#include <vector>
 
 namespace otto::util {
 
@@ -12,16 +13,31 @@ namespace otto::util {
 
     Event() = default;
 
+    /// Add a handler, and get an id to {@ref unsubscribe} it with
+    ///
+    /// The slots of handlers that were unsubscribed are reused, so engines that subscribe and
+    /// unsubscribe as they are created and destroyed don't grow the list.
     int subscribe(handler_type handler)
     {
+      auto free = std::find(handlers.begin(), handlers.end(), nullptr);
+      if (free != handlers.end()) {
+        *free = std::move(handler);
+        return free - handlers.begin();
+      }
       handlers.emplace_back(std::move(handler));
       return handlers.size() - 1;
     }
 
+    /// Remove the handler `subscribe` returned `id` for. The ids of the other handlers stay valid.
+    void unsubscribe(int id)
+    {
+      handlers[id] = nullptr;
+    }
+
     void fire(Args... args)
     {
       for (auto& handler : handlers) {
-        handler(args...);
+        if (handler) handler(args...);
       }
     }
 
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+
+namespace otto::util {
+
+  /// A lock-free histogram of durations, for finding the tail latencies of the audio thread
+  ///
+  /// Durations are in microseconds, and sorted into buckets an eighth of an octave wide, from
+  /// 1µs to about 16s. Percentiles are accurate to the width of a bucket, about 9%. The
+  /// maximum is exact.
+  ///
+  /// Recording never blocks or allocates, and can be done from any number of threads. Reading can
+  /// happen at the same time, from any thread, and sees a consistent enough picture for
+  /// statistics.
+  struct LatencyHistogram {
+    static constexpr int buckets_per_octave = 8;
+    static constexpr int octaves = 24;
+    /// Bucket 0 holds everything below 1µs, and the last one everything above the range
+    static constexpr int bucket_count = octaves * buckets_per_octave + 2;
+
+    struct Summary {
+      std::uint64_t count = 0;
+      float p50 = 0;
+      float p99 = 0;
+      float max = 0;
+    };
+
+    /// Record a duration, in microseconds
+    void record(float us) noexcept
+    {
+      _buckets[bucket_of(us)].fetch_add(1, std::memory_order_relaxed);
+      _count.fetch_add(1, std::memory_order_relaxed);
+      float max = _max.load(std::memory_order_relaxed);
+      while (us > max && !_max.compare_exchange_weak(max, us, std::memory_order_relaxed))
+        ;
+    }
+
+    /// The number of recorded durations
+    std::uint64_t count() const noexcept
+    {
+      return _count.load(std::memory_order_relaxed);
+    }
+
+    /// The longest recorded duration
+    float max() const noexcept
+    {
+      return _max.load(std::memory_order_relaxed);
+    }
+
+    /// The duration that a share `p` of the recorded durations are at or below
+    ///
+    /// @param p in `[0, 1]`
+    /// @return the upper edge of the bucket the percentile falls in, or 0 if nothing has been
+    /// recorded
+    float percentile(float p) const noexcept
+    {
+      std::uint64_t total = count();
+      if (total == 0) return 0;
+      auto rank = std::max<std::uint64_t>(1, std::ceil(p * total));
+      std::uint64_t seen = 0;
+      for (int i = 0; i < bucket_count; i++) {
+        seen += _buckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank) return std::min(upper_edge(i), max());
+      }
+      return max();
+    }
+
+    Summary summary() const noexcept
+    {
+      return {count(), percentile(0.5f), percentile(0.99f), max()};
+    }
+
+    /// Start over
+    ///
+    /// Durations recorded while clearing may be partly lost.
+    void clear() noexcept
+    {
+      for (auto& b : _buckets) b.store(0, std::memory_order_relaxed);
+      _count = 0;
+      _max = 0;
+    }
+
+  private:
+    static int bucket_of(float us) noexcept
+    {
+      if (!(us >= 1)) return 0;
+      int i = 1 + static_cast<int>(std::log2(us) * buckets_per_octave);
+      return std::min(i, bucket_count - 1);
+    }
+
+    static float upper_edge(int bucket) noexcept
+    {
+      return std::exp2(float(bucket) / buckets_per_octave);
+    }
+
+    std::array<std::atomic<std::uint32_t>, bucket_count> _buckets = {};
+    std::atomic<std::uint64_t> _count = 0;
+    std::atomic<float> _max = 0;
+  };
+
+} // namespace otto::util
@@ -1,16 +1,27 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
+#include <initializer_list>
 
 namespace otto::util {
 
+  /// A vector with a fixed capacity, stored inline
+  ///
+  /// Never allocates. Pushing to a full vector is a precondition violation, so check
+  /// {@ref full()} first where that can happen.
   template<typename T, std::size_t Capacity>
   struct local_vector {
     using value_type = T;
     using iterator = typename std::array<T, Capacity>::iterator;
     using const_iterator = typename std::array<T, Capacity>::const_iterator;
 
-    constexpr local_vector(std::initializer_list<value_type> il) : _data(il), _size(il.size()) {}
+    constexpr local_vector() noexcept = default;
+
+    constexpr local_vector(std::initializer_list<value_type> il) : _size(il.size())
+    {
+      std::copy(il.begin(), il.end(), _data.begin());
+    }
 
     // Queries
 
@@ -24,6 +35,26 @@ namespace otto::util {
       return _size;
     }
 
+    constexpr bool empty() const noexcept
+    {
+      return _size == 0;
+    }
+
+    constexpr bool full() const noexcept
+    {
+      return _size == Capacity;
+    }
+
+    constexpr value_type* data() noexcept
+    {
+      return _data.data();
+    }
+
+    constexpr const value_type* data() const noexcept
+    {
+      return _data.data();
+    }
+
     constexpr auto begin()
     {
       return _data.begin();
@@ -64,13 +95,48 @@ namespace otto::util {
       return _data[_size - 1];
     }
 
-    constexpr const value_type& operator[](std::size_t idx)
+    constexpr value_type& operator[](std::size_t idx)
     {
       return _data[idx];
     }
 
+    constexpr const value_type& operator[](std::size_t idx) const
+    {
+      return _data[idx];
+    }
+
+    // Modifiers
+
+    constexpr void push_back(const value_type& v)
+    {
+      _data[_size++] = v;
+    }
+
+    constexpr void push_back(value_type&& v)
+    {
+      _data[_size++] = std::move(v);
+    }
+
+    template<typename... Args>
+    constexpr value_type& emplace_back(Args&&... args)
+    {
+      _data[_size] = value_type(std::forward<Args>(args)...);
+      return _data[_size++];
+    }
+
+    constexpr void pop_back()
+    {
+      _size--;
+    }
+
+    /// Set the size to 0. Does not destroy the elements
+    constexpr void clear() noexcept
+    {
+      _size = 0;
+    }
+
   private:
-    std::array<value_type, capacity()> _data;
-    std::size_t _size;
+    std::array<value_type, capacity()> _data = {};
+    std::size_t _size = 0;
   };
 } // namespace otto::util
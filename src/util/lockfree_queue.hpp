@@ -0,0 +1,270 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace otto::util {
+
+  namespace detail {
+    /// Size used to keep producer and consumer indices on separate cache lines
+    constexpr std::size_t cache_line_size = 64;
+
+    constexpr bool is_power_of_two(std::size_t n) noexcept
+    {
+      return n != 0 && (n & (n - 1)) == 0;
+    }
+
+    /// Uninitialized storage for a single `T`
+    template<typename T>
+    struct queue_slot {
+      template<typename... Args>
+      void construct(Args&&... args) noexcept(std::is_nothrow_constructible_v<T, Args...>)
+      {
+        new (&storage) T(std::forward<Args>(args)...);
+      }
+
+      /// Move the value out, and destroy the stored object
+      T take() noexcept(std::is_nothrow_move_constructible_v<T>)
+      {
+        T& ref = *std::launder(reinterpret_cast<T*>(&storage));
+        T res = std::move(ref);
+        ref.~T();
+        return res;
+      }
+
+      std::aligned_storage_t<sizeof(T), alignof(T)> storage;
+    };
+  } // namespace detail
+
+  /// A bounded, wait-free, single producer single consumer queue
+  ///
+  /// One thread may push, and one (other) thread may pop, concurrently, without ever blocking
+  /// each other. Neither side allocates. When the queue is full, `try_push` fails, and it is up
+  /// to the producer to decide what to do about it.
+  ///
+  /// @tparam T the element type. Does not need to be default constructible.
+  /// @tparam Capacity the maximum number of elements. Must be a power of two.
+  template<typename T, std::size_t Capacity>
+  struct spsc_queue {
+    static_assert(detail::is_power_of_two(Capacity), "spsc_queue: Capacity must be a power of two");
+
+    using value_type = T;
+
+    spsc_queue() noexcept = default;
+    spsc_queue(const spsc_queue&) = delete;
+    spsc_queue& operator=(const spsc_queue&) = delete;
+
+    ~spsc_queue() noexcept
+    {
+      while (try_pop()) {
+      }
+    }
+
+    static constexpr std::size_t capacity() noexcept
+    {
+      return Capacity;
+    }
+
+    /// Push an element. Only call this from the producer thread.
+    ///
+    /// @return false if the queue was full. The element is not moved from in that case.
+    template<typename... Args>
+    bool try_emplace(Args&&... args)
+    {
+      auto head = _head.load(std::memory_order_relaxed);
+      if (head - _tail.load(std::memory_order_acquire) == Capacity) return false;
+      _slots[head & mask].construct(std::forward<Args>(args)...);
+      _head.store(head + 1, std::memory_order_release);
+      return true;
+    }
+
+    bool try_push(const T& v)
+    {
+      return try_emplace(v);
+    }
+
+    bool try_push(T&& v)
+    {
+      return try_emplace(std::move(v));
+    }
+
+    /// Pop an element into `out`. Only call this from the consumer thread.
+    ///
+    /// @return false if the queue was empty
+    bool try_pop(T& out)
+    {
+      auto tail = _tail.load(std::memory_order_relaxed);
+      if (tail == _head.load(std::memory_order_acquire)) return false;
+      out = _slots[tail & mask].take();
+      _tail.store(tail + 1, std::memory_order_release);
+      return true;
+    }
+
+    /// Pop and discard an element. Only call this from the consumer thread.
+    bool try_pop()
+    {
+      auto tail = _tail.load(std::memory_order_relaxed);
+      if (tail == _head.load(std::memory_order_acquire)) return false;
+      _slots[tail & mask].take();
+      _tail.store(tail + 1, std::memory_order_release);
+      return true;
+    }
+
+    /// Pop at most `max` elements, calling `f` with each one. Only call this from the consumer
+    /// thread.
+    ///
+    /// @return the number of elements consumed
+    template<typename Func>
+    std::size_t consume(Func&& f, std::size_t max = Capacity)
+    {
+      auto tail = _tail.load(std::memory_order_relaxed);
+      auto head = _head.load(std::memory_order_acquire);
+      std::size_t n = 0;
+      for (; tail != head && n < max; ++tail, ++n) {
+        f(_slots[tail & mask].take());
+      }
+      _tail.store(tail, std::memory_order_release);
+      return n;
+    }
+
+    /// Approximate number of elements. Exact when called from either thread while the other is
+    /// idle.
+    std::size_t size() const noexcept
+    {
+      return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire);
+    }
+
+    bool empty() const noexcept
+    {
+      return size() == 0;
+    }
+
+  private:
+    static constexpr std::size_t mask = Capacity - 1;
+
+    alignas(detail::cache_line_size) std::atomic<std::size_t> _head = 0;
+    alignas(detail::cache_line_size) std::atomic<std::size_t> _tail = 0;
+    std::array<detail::queue_slot<T>, Capacity> _slots;
+  };
+
+  /// A bounded, lock-free, multiple producer single consumer queue
+  ///
+  /// Any number of threads may push concurrently, while one thread pops. Producers only contend
+  /// with each other on a single compare-and-swap, and never wait for the consumer. The consumer
+  /// never waits at all, which makes this suitable for feeding the audio thread.
+  ///
+  /// Based on Dmitry Vyukov's bounded MPMC queue, with the consumer side simplified.
+  ///
+  /// @tparam T the element type. Does not need to be default constructible.
+  /// @tparam Capacity the maximum number of elements. Must be a power of two.
+  template<typename T, std::size_t Capacity>
+  struct mpsc_queue {
+    static_assert(detail::is_power_of_two(Capacity), "mpsc_queue: Capacity must be a power of two");
+
+    using value_type = T;
+
+    mpsc_queue() noexcept
+    {
+      for (std::size_t i = 0; i < Capacity; i++) {
+        _cells[i].sequence.store(i, std::memory_order_relaxed);
+      }
+    }
+
+    mpsc_queue(const mpsc_queue&) = delete;
+    mpsc_queue& operator=(const mpsc_queue&) = delete;
+
+    ~mpsc_queue() noexcept
+    {
+      consume([](T&&) {});
+    }
+
+    static constexpr std::size_t capacity() noexcept
+    {
+      return Capacity;
+    }
+
+    /// Push an element. May be called from any thread.
+    ///
+    /// @return false if the queue was full. The element is not moved from in that case.
+    template<typename... Args>
+    bool try_emplace(Args&&... args)
+    {
+      auto pos = _head.load(std::memory_order_relaxed);
+      for (;;) {
+        auto& cell = _cells[pos & mask];
+        auto seq = cell.sequence.load(std::memory_order_acquire);
+        auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+        if (diff == 0) {
+          if (_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+            cell.slot.construct(std::forward<Args>(args)...);
+            cell.sequence.store(pos + 1, std::memory_order_release);
+            return true;
+          }
+        } else if (diff < 0) {
+          return false;
+        } else {
+          pos = _head.load(std::memory_order_relaxed);
+        }
+      }
+    }
+
+    bool try_push(const T& v)
+    {
+      return try_emplace(v);
+    }
+
+    bool try_push(T&& v)
+    {
+      return try_emplace(std::move(v));
+    }
+
+    /// Pop an element into `out`. Only call this from the consumer thread.
+    ///
+    /// @return false if the queue was empty, or the next element is still being written
+    bool try_pop(T& out)
+    {
+      auto& cell = _cells[_tail & mask];
+      if (cell.sequence.load(std::memory_order_acquire) != _tail + 1) return false;
+      out = cell.slot.take();
+      cell.sequence.store(_tail + Capacity, std::memory_order_release);
+      ++_tail;
+      return true;
+    }
+
+    /// Pop at most `max` elements, calling `f` with each one. Only call this from the consumer
+    /// thread.
+    ///
+    /// @return the number of elements consumed
+    template<typename Func>
+    std::size_t consume(Func&& f, std::size_t max = Capacity)
+    {
+      std::size_t n = 0;
+      for (; n < max; n++) {
+        auto& cell = _cells[_tail & mask];
+        if (cell.sequence.load(std::memory_order_acquire) != _tail + 1) break;
+        f(cell.slot.take());
+        cell.sequence.store(_tail + Capacity, std::memory_order_release);
+        ++_tail;
+      }
+      return n;
+    }
+
+  private:
+    static constexpr std::size_t mask = Capacity - 1;
+
+    struct Cell {
+      std::atomic<std::size_t> sequence;
+      detail::queue_slot<T> slot;
+    };
+
+    alignas(detail::cache_line_size) std::atomic<std::size_t> _head = 0;
+    /// Only touched by the consumer
+    alignas(detail::cache_line_size) std::size_t _tail = 0;
+    std::array<Cell, Capacity> _cells;
+  };
+
+} // namespace otto::util
@@ -0,0 +1,296 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define OTTO_SIMD_NEON 1
+#include <arm_neon.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#define OTTO_SIMD_SSE 1
+#include <emmintrin.h>
+#else
+#define OTTO_SIMD_SCALAR 1
+#endif
+
+/// A minimal portable layer over 4-wide float SIMD
+///
+/// Uses NEON on ARM (the Pi builds with `-mfpu=neon-vfpv4`), SSE2 on x86_64, and a plain scalar
+/// fallback everywhere else. Only the operations the DSP kernels actually need are provided.
+namespace otto::util::simd {
+
+  /// Number of floats in a {@ref float4}
+  constexpr int width = 4;
+
+  /// Alignment required by {@ref float4::load} and {@ref float4::store}
+  constexpr std::size_t alignment = 16;
+
+  /// Round `n` up to a multiple of {@ref width}
+  constexpr int padded(int n) noexcept
+  {
+    return (n + width - 1) / width * width;
+  }
+
+  /// Four packed floats
+  struct float4 {
+#if OTTO_SIMD_NEON
+    using native_type = float32x4_t;
+#elif OTTO_SIMD_SSE
+    using native_type = __m128;
+#else
+    struct native_type {
+      float v[4];
+    };
+#endif
+
+    float4() noexcept = default;
+    float4(native_type n) noexcept : v(n) {}
+
+    /// Broadcast `f` to all lanes
+    float4(float f) noexcept
+    {
+#if OTTO_SIMD_NEON
+      v = vdupq_n_f32(f);
+#elif OTTO_SIMD_SSE
+      v = _mm_set1_ps(f);
+#else
+      v = {{f, f, f, f}};
+#endif
+    }
+
+    /// Construct from four lane values
+    float4(float a, float b, float c, float d) noexcept
+    {
+#if OTTO_SIMD_NEON
+      alignas(alignment) float tmp[4] = {a, b, c, d};
+      v = vld1q_f32(tmp);
+#elif OTTO_SIMD_SSE
+      v = _mm_setr_ps(a, b, c, d);
+#else
+      v = {{a, b, c, d}};
+#endif
+    }
+
+    /// Load four floats from `ptr`, which must be aligned to {@ref alignment}
+    static float4 load(const float* ptr) noexcept
+    {
+#if OTTO_SIMD_NEON
+      return vld1q_f32(ptr);
+#elif OTTO_SIMD_SSE
+      return _mm_load_ps(ptr);
+#else
+      return native_type{{ptr[0], ptr[1], ptr[2], ptr[3]}};
+#endif
+    }
+
+    /// Load four floats from an unaligned `ptr`
+    static float4 loadu(const float* ptr) noexcept
+    {
+#if OTTO_SIMD_NEON
+      return vld1q_f32(ptr);
+#elif OTTO_SIMD_SSE
+      return _mm_loadu_ps(ptr);
+#else
+      return load(ptr);
+#endif
+    }
+
+    /// Store four floats to `ptr`, which must be aligned to {@ref alignment}
+    void store(float* ptr) const noexcept
+    {
+#if OTTO_SIMD_NEON
+      vst1q_f32(ptr, v);
+#elif OTTO_SIMD_SSE
+      _mm_store_ps(ptr, v);
+#else
+      for (int i = 0; i < 4; i++) ptr[i] = v.v[i];
+#endif
+    }
+
+    /// Store four floats to an unaligned `ptr`
+    void storeu(float* ptr) const noexcept
+    {
+#if OTTO_SIMD_SSE
+      _mm_storeu_ps(ptr, v);
+#else
+      store(ptr);
+#endif
+    }
+
+    friend float4 operator+(float4 a, float4 b) noexcept
+    {
+#if OTTO_SIMD_NEON
+      return vaddq_f32(a.v, b.v);
+#elif OTTO_SIMD_SSE
+      return _mm_add_ps(a.v, b.v);
+#else
+      return {a.v.v[0] + b.v.v[0], a.v.v[1] + b.v.v[1], a.v.v[2] + b.v.v[2], a.v.v[3] + b.v.v[3]};
+#endif
+    }
+
+    friend float4 operator-(float4 a, float4 b) noexcept
+    {
+#if OTTO_SIMD_NEON
+      return vsubq_f32(a.v, b.v);
+#elif OTTO_SIMD_SSE
+      return _mm_sub_ps(a.v, b.v);
+#else
+      return {a.v.v[0] - b.v.v[0], a.v.v[1] - b.v.v[1], a.v.v[2] - b.v.v[2], a.v.v[3] - b.v.v[3]};
+#endif
+    }
+
+    friend float4 operator*(float4 a, float4 b) noexcept
+    {
+#if OTTO_SIMD_NEON
+      return vmulq_f32(a.v, b.v);
+#elif OTTO_SIMD_SSE
+      return _mm_mul_ps(a.v, b.v);
+#else
+      return {a.v.v[0] * b.v.v[0], a.v.v[1] * b.v.v[1], a.v.v[2] * b.v.v[2], a.v.v[3] * b.v.v[3]};
+#endif
+    }
+
+    float4& operator+=(float4 rhs) noexcept
+    {
+      return *this = *this + rhs;
+    }
+
+    float4& operator-=(float4 rhs) noexcept
+    {
+      return *this = *this - rhs;
+    }
+
+    float4& operator*=(float4 rhs) noexcept
+    {
+      return *this = *this * rhs;
+    }
+
+    /// `a * b + c`
+    friend float4 fma(float4 a, float4 b, float4 c) noexcept
+    {
+#if OTTO_SIMD_NEON
+      return vmlaq_f32(c.v, a.v, b.v);
+#else
+      return a * b + c;
+#endif
+    }
+
+    friend float4 min(float4 a, float4 b) noexcept
+    {
+#if OTTO_SIMD_NEON
+      return vminq_f32(a.v, b.v);
+#elif OTTO_SIMD_SSE
+      return _mm_min_ps(a.v, b.v);
+#else
+      return {std::fmin(a.v.v[0], b.v.v[0]), std::fmin(a.v.v[1], b.v.v[1]),
+              std::fmin(a.v.v[2], b.v.v[2]), std::fmin(a.v.v[3], b.v.v[3])};
+#endif
+    }
+
+    friend float4 max(float4 a, float4 b) noexcept
+    {
+#if OTTO_SIMD_NEON
+      return vmaxq_f32(a.v, b.v);
+#elif OTTO_SIMD_SSE
+      return _mm_max_ps(a.v, b.v);
+#else
+      return {std::fmax(a.v.v[0], b.v.v[0]), std::fmax(a.v.v[1], b.v.v[1]),
+              std::fmax(a.v.v[2], b.v.v[2]), std::fmax(a.v.v[3], b.v.v[3])};
+#endif
+    }
+
+    /// Absolute value of each lane
+    friend float4 abs(float4 a) noexcept
+    {
+#if OTTO_SIMD_NEON
+      return vabsq_f32(a.v);
+#elif OTTO_SIMD_SSE
+      return _mm_andnot_ps(_mm_set1_ps(-0.f), a.v);
+#else
+      return {std::fabs(a.v.v[0]), std::fabs(a.v.v[1]), std::fabs(a.v.v[2]), std::fabs(a.v.v[3])};
+#endif
+    }
+
+    /// Round each lane towards negative infinity
+    ///
+    /// Only valid for values that fit in an `int32_t`, which is all the DSP code needs.
+    friend float4 floor(float4 a) noexcept
+    {
+#if OTTO_SIMD_NEON
+      float32x4_t t = vcvtq_f32_s32(vcvtq_s32_f32(a.v));
+      uint32x4_t gt = vcgtq_f32(t, a.v);
+      uint32x4_t one = vreinterpretq_u32_f32(vdupq_n_f32(1.f));
+      return vsubq_f32(t, vreinterpretq_f32_u32(vandq_u32(gt, one)));
+#elif OTTO_SIMD_SSE
+      __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a.v));
+      __m128 gt = _mm_cmpgt_ps(t, a.v);
+      return _mm_sub_ps(t, _mm_and_ps(gt, _mm_set1_ps(1.f)));
+#else
+      return {std::floor(a.v.v[0]), std::floor(a.v.v[1]), std::floor(a.v.v[2]),
+              std::floor(a.v.v[3])};
+#endif
+    }
+
+    /// Wrap each lane into `[0, 1)`
+    friend float4 wrap(float4 a) noexcept
+    {
+      return a - floor(a);
+    }
+
+    /// Sum of all four lanes
+    friend float sum(float4 a) noexcept
+    {
+#if OTTO_SIMD_NEON
+      float32x2_t s = vadd_f32(vget_low_f32(a.v), vget_high_f32(a.v));
+      return vget_lane_f32(vpadd_f32(s, s), 0);
+#else
+      alignas(alignment) float tmp[4];
+      a.store(tmp);
+      return (tmp[0] + tmp[1]) + (tmp[2] + tmp[3]);
+#endif
+    }
+
+    native_type v;
+  };
+
+  /// Interleave the lanes of `a` and `b`, so `lo = {a0, b0, a1, b1}` and `hi = {a2, b2, a3, b3}`
+  inline void interleave(float4 a, float4 b, float4& lo, float4& hi) noexcept
+  {
+#if OTTO_SIMD_NEON
+    float32x4x2_t z = vzipq_f32(a.v, b.v);
+    lo = z.val[0];
+    hi = z.val[1];
+#elif OTTO_SIMD_SSE
+    lo = _mm_unpacklo_ps(a.v, b.v);
+    hi = _mm_unpackhi_ps(a.v, b.v);
+#else
+    lo = {a.v.v[0], b.v.v[0], a.v.v[1], b.v.v[1]};
+    hi = {a.v.v[2], b.v.v[2], a.v.v[3], b.v.v[3]};
+#endif
+  }
+
+  /// The inverse of {@ref interleave}: split interleaved lanes into the even ones and the odd ones
+  inline void deinterleave(float4 lo, float4 hi, float4& a, float4& b) noexcept
+  {
+#if OTTO_SIMD_NEON
+    float32x4x2_t u = vuzpq_f32(lo.v, hi.v);
+    a = u.val[0];
+    b = u.val[1];
+#elif OTTO_SIMD_SSE
+    a = _mm_shuffle_ps(lo.v, hi.v, _MM_SHUFFLE(2, 0, 2, 0));
+    b = _mm_shuffle_ps(lo.v, hi.v, _MM_SHUFFLE(3, 1, 3, 1));
+#else
+    a = {lo.v.v[0], lo.v.v[2], hi.v.v[0], hi.v.v[2]};
+    b = {lo.v.v[1], lo.v.v[3], hi.v.v[1], hi.v.v[3]};
+#endif
+  }
+
+  /// The largest of the four lanes
+  inline float hmax(float4 a) noexcept
+  {
+    alignas(alignment) float tmp[4];
+    a.store(tmp);
+    return std::fmax(std::fmax(tmp[0], tmp[1]), std::fmax(tmp[2], tmp[3]));
+  }
+
+} // namespace otto::util::simd
@@ -0,0 +1,150 @@
+#include "timer.hpp"
+
+#if OTTO_ENABLE_TIMERS
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+
+#include "util/lockfree_queue.hpp"
+#endif
+
+#include "services/log_manager.hpp"
+
+namespace otto::util::timer {
+
+#if OTTO_ENABLE_TIMERS
+
+  namespace {
+    struct Sample {
+      const char* name;
+      float us;
+    };
+
+    /// The timings of one thread, waiting to be aggregated
+    struct ThreadBuffer {
+      spsc_queue<Sample, 4096> queue;
+      std::atomic_int dropped = 0;
+    };
+
+    struct Stats {
+      LatencyHistogram histogram;
+      double total_us = 0;
+    };
+
+    /// Owns the buffers of all threads, and drains them into the stats every 100ms
+    struct Aggregator {
+      Aggregator() : thread([this] { run(); }) {}
+
+      ~Aggregator()
+      {
+        should_run = false;
+        thread.join();
+      }
+
+      ThreadBuffer& register_thread()
+      {
+        std::lock_guard lock(mutex);
+        return *buffers.emplace_back(std::make_unique<ThreadBuffer>());
+      }
+
+      /// Call with the mutex locked
+      void drain()
+      {
+        for (auto& buf : buffers) {
+          buf->queue.consume([this](Sample&& sample) {
+            auto found = stats.find(std::string_view(sample.name));
+            if (found == stats.end()) found = stats.try_emplace(sample.name).first;
+            found->second.histogram.record(sample.us);
+            found->second.total_us += sample.us;
+          });
+          dropped += buf->dropped.exchange(0);
+        }
+      }
+
+      void run()
+      {
+        while (should_run) {
+          {
+            std::lock_guard lock(mutex);
+            drain();
+          }
+          std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+      }
+
+      std::mutex mutex;
+      std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+      std::map<std::string, Stats, std::less<>> stats;
+      int dropped = 0;
+      std::atomic_bool should_run = true;
+      /// Started last, when everything else is constructed
+      std::thread thread;
+    };
+
+    Aggregator& aggregator()
+    {
+      static Aggregator instance;
+      return instance;
+    }
+
+    ThreadBuffer& thread_buffer()
+    {
+      thread_local ThreadBuffer& buffer = aggregator().register_thread();
+      return buffer;
+    }
+  } // namespace
+
+  ScopeTimer::~ScopeTimer() noexcept
+  {
+    float us = std::chrono::duration<float, std::micro>(clock::now() - start).count();
+    auto& buffer = thread_buffer();
+    if (!buffer.queue.try_push({name, us})) buffer.dropped++;
+  }
+
+  std::vector<Timing> summary()
+  {
+    auto& agg = aggregator();
+    std::lock_guard lock(agg.mutex);
+    agg.drain();
+    std::vector<Timing> res;
+    res.reserve(agg.stats.size());
+    for (auto& [name, stats] : agg.stats) {
+      res.push_back({name, stats.histogram.summary(), stats.total_us / 1000});
+    }
+    std::sort(res.begin(), res.end(), [](auto& a, auto& b) { return a.total_ms > b.total_ms; });
+    return res;
+  }
+
+  void log_summary()
+  {
+    auto timings = summary();
+    LOGI("Timers, by total time:");
+    for (auto& t : timings) {
+      LOGI("{:<24} total {:9.1f}ms  p50 {:7.1f}us  p99 {:7.1f}us  max {:7.1f}us  ({} calls)",
+           t.name, t.total_ms, t.summary.p50, t.summary.p99, t.summary.max, t.summary.count);
+    }
+    std::lock_guard lock(aggregator().mutex);
+    LOGW_IF(aggregator().dropped > 0, "{} timings were dropped, because the buffers were full",
+            aggregator().dropped);
+  }
+
+#else
+
+  ScopeTimer::~ScopeTimer() noexcept {}
+
+  std::vector<Timing> summary()
+  {
+    return {};
+  }
+
+  void log_summary() {}
+
+#endif
+
+} // namespace otto::util::timer
+
+// kak: other_file=timer.hpp
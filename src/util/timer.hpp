@@ -0,0 +1,76 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "util/histogram.hpp"
+
+#ifndef OTTO_ENABLE_TIMERS
+#define OTTO_ENABLE_TIMERS 0
+#endif
+
+/// Scoped timers, for finding out what the audio thread spends its time on
+///
+/// Enabled with the `ENABLE_TIMERS` cmake option. When it is off, {@ref TIME_SCOPE} expands to
+/// nothing, and the rest of this namespace does nothing.
+///
+/// ```cpp
+/// void Engine::process()
+/// {
+///   TIME_SCOPE("Engine::process");
+///   ...
+/// }
+/// ```
+///
+/// Each thread writes its timings to its own lock-free ring buffer, so timing a scope costs two
+/// clock reads and a push. A background thread drains the buffers into one histogram per name.
+/// The first timed scope on a thread allocates its buffer, so a thread may hiccup once.
+namespace otto::util::timer {
+
+  using clock = std::chrono::steady_clock;
+
+  /// Times the scope it lives in. Use {@ref TIME_SCOPE} instead
+  struct ScopeTimer {
+    /// @param name must outlive the program, like a string literal or an engine name
+    ScopeTimer(const char* name) noexcept : name(name), start(clock::now()) {}
+    ~ScopeTimer() noexcept;
+
+    ScopeTimer(const ScopeTimer&) = delete;
+    ScopeTimer& operator=(const ScopeTimer&) = delete;
+
+  private:
+    const char* name;
+    clock::time_point start;
+  };
+
+  struct Timing {
+    std::string name;
+    LatencyHistogram::Summary summary;
+    /// The time spent in the scope in total, in milliseconds
+    double total_ms = 0;
+  };
+
+  /// The timings of all scopes so far, sorted by their total time, most first
+  std::vector<Timing> summary();
+
+  /// Log {@ref summary}
+  void log_summary();
+
+} // namespace otto::util::timer
+
+#define OTTO_TIMER_CONCAT_(a, b) a##b
+#define OTTO_TIMER_CONCAT(a, b) OTTO_TIMER_CONCAT_(a, b)
+
+#if OTTO_ENABLE_TIMERS
+/// Time the rest of the enclosing scope, under `name`
+#define TIME_SCOPE(name)                                                                           \
+  ::otto::util::timer::ScopeTimer OTTO_TIMER_CONCAT(_otto_scope_timer_, __LINE__)                  \
+  {                                                                                                \
+    name                                                                                           \
+  }
+#else
+#define TIME_SCOPE(name)
+#endif
+
+// kak: other_file=timer.cpp
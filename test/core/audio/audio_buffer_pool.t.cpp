@@ -0,0 +1,146 @@
+#include "testing.t.hpp"
+
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "core/audio/processor.hpp"
+
+namespace otto::core::audio {
+
+  TEST_CASE ("AudioBufferPool", "[audio][pool]") {
+    AudioBufferPool pool{64};
+    const int capacity = AudioBufferPool::default_capacity;
+
+    /// Allocate every buffer that is left in the pool
+    auto allocate_all = [&] {
+      std::vector<AudioBufferHandle> res;
+      int overflows = pool.overflows();
+      while (true) {
+        auto buf = pool.allocate();
+        if (pool.overflows() != overflows) break;
+        res.push_back(std::move(buf));
+      }
+      return res;
+    };
+
+    SECTION ("Allocates up to its capacity, without overflowing") {
+      REQUIRE(pool.capacity() == capacity);
+      std::vector<AudioBufferHandle> bufs;
+      std::set<float*> distinct;
+      for (int i = 0; i < capacity; i++) {
+        auto& buf = bufs.emplace_back(pool.allocate());
+        distinct.insert(buf.data());
+        REQUIRE(buf.size() == 64);
+        REQUIRE(buf.is_aligned());
+        REQUIRE(buf.reference_count() == 1);
+      }
+      REQUIRE(int(distinct.size()) == capacity);
+      REQUIRE(pool.overflows() == 0);
+      REQUIRE(pool.peak() == capacity);
+    }
+
+    SECTION ("Released buffers are reused") {
+      auto bufs = allocate_all();
+      REQUIRE(int(bufs.size()) == capacity);
+      float* released = bufs[3].data();
+      bufs[3].release();
+      REQUIRE(bufs[3].data() == nullptr);
+      auto buf = pool.allocate();
+      REQUIRE(buf.data() == released);
+      bufs.clear();
+      buf.release();
+      REQUIRE(int(allocate_all().size()) == capacity);
+    }
+
+    SECTION ("Copies and slices keep the buffer out of the pool") {
+      auto buf = pool.allocate();
+      float* data = buf.data();
+      auto copy = buf;
+      auto slice = buf.slice(16, 8);
+      REQUIRE(buf.reference_count() == 3);
+      REQUIRE(slice.data() == data + 16);
+      REQUIRE(slice.size() == 8);
+
+      buf.release();
+      copy.release();
+      // Only the slice is left, and the buffer is still in use
+      auto others = allocate_all();
+      REQUIRE(int(others.size()) == capacity - 1);
+      for (auto& b : others) REQUIRE(b.data() != data);
+
+      others.clear();
+      slice.release();
+      REQUIRE(int(allocate_all().size()) == capacity);
+    }
+
+    SECTION ("Moves transfer the reference") {
+      auto buf = pool.allocate();
+      float* data = buf.data();
+      AudioBufferHandle moved = std::move(buf);
+      REQUIRE(buf.data() == nullptr);
+      REQUIRE(moved.data() == data);
+      REQUIRE(moved.reference_count() == 1);
+
+      AudioBufferHandle assigned;
+      assigned = std::move(moved);
+      REQUIRE(assigned.reference_count() == 1);
+      // Assigning over a handle releases what it held
+      assigned = pool.allocate();
+      REQUIRE(int(allocate_all().size()) == capacity - 1);
+    }
+
+    SECTION ("An empty pool hands out the shared overflow buffer, and counts it") {
+      auto bufs = allocate_all();
+      REQUIRE(pool.overflows() == 1);
+      auto a = pool.allocate();
+      auto b = pool.allocate();
+      REQUIRE(pool.overflows() == 3);
+      REQUIRE(a.data() == b.data());
+      REQUIRE(a.data() != nullptr);
+      REQUIRE_FALSE(a.is_aligned());
+      for (auto& buf : bufs) REQUIRE(buf.data() != a.data());
+
+      // Releasing the overflow buffer does not add it to the pool
+      a.release();
+      b.release();
+      bufs.clear();
+      REQUIRE(int(allocate_all().size()) == capacity);
+    }
+
+    SECTION ("reserve grows the pool") {
+      pool.reserve(capacity + 4);
+      REQUIRE(pool.capacity() == capacity + 4);
+      REQUIRE(int(allocate_all().size()) == capacity + 4);
+      pool.reserve(2);
+      REQUIRE(pool.capacity() == capacity + 4);
+    }
+
+    SECTION ("Concurrent allocation and release") {
+      constexpr int iterations = 20000;
+      std::atomic_bool clash = false;
+      auto run = [&](float id) {
+        for (int i = 0; i < iterations; i++) {
+          auto bufs = pool.allocate_multi<3>();
+          for (auto& buf : bufs) std::fill(buf.begin(), buf.end(), id);
+          std::this_thread::yield();
+          // No other thread was handed the same buffers in the meantime
+          for (auto& buf : bufs) {
+            if (std::any_of(buf.begin(), buf.end(), [&](float f) { return f != id; })) {
+              clash = true;
+            }
+          }
+        }
+      };
+      std::thread other(run, 1.f);
+      run(2.f);
+      other.join();
+
+      REQUIRE_FALSE(clash);
+      REQUIRE(pool.overflows() == 0);
+      REQUIRE(pool.peak() <= 6);
+      REQUIRE(int(allocate_all().size()) == capacity);
+    }
+  }
+
+} // namespace otto::core::audio
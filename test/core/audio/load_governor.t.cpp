@@ -0,0 +1,54 @@
+#include "testing.t.hpp"
+
+#include "core/audio/load_governor.hpp"
+
+namespace otto::core::audio {
+
+  TEST_CASE ("LoadGovernor", "[audio][governor]") {
+    LoadGovernor governor;
+    // 256 frames at 48kHz
+    constexpr float period = 256.f / 48000.f;
+    auto run = [&](float load, float seconds) {
+      for (float t = 0; t < seconds; t += period) governor.report(load, period);
+    };
+
+    SECTION ("Stays at full quality under normal load") {
+      run(0.5, 10);
+      REQUIRE(governor.level() == 0);
+      REQUIRE(governor.full_quality());
+      REQUIRE(governor.voice_limit(6) == 6);
+    }
+
+    SECTION ("A single slow block sheds a level, but only one") {
+      run(0.3, 1);
+      governor.report(0.95, period);
+      run(0.3, LoadGovernor::hold_time / 2);
+      REQUIRE(governor.level() == 1);
+      REQUIRE_FALSE(governor.full_quality());
+      REQUIRE(governor.voice_limit(6) == 6);
+    }
+
+    SECTION ("Sustained load sheds voices, down to one") {
+      run(0.9, 10);
+      REQUIRE(governor.level() == LoadGovernor::max_level);
+      REQUIRE(governor.voice_limit(16) == 2);
+      REQUIRE(governor.voice_limit(6) == 1);
+    }
+
+    SECTION ("Levels are restored one at a time when the load drops") {
+      run(0.9, 10);
+      run(0.2, LoadGovernor::restore_time * 1.5f);
+      REQUIRE(governor.level() == LoadGovernor::max_level - 1);
+      run(0.2, LoadGovernor::restore_time * LoadGovernor::max_level);
+      REQUIRE(governor.level() == 0);
+    }
+
+    SECTION ("Load between the thresholds keeps the level") {
+      run(0.9, 1);
+      int level = governor.level();
+      run(0.6, 10);
+      REQUIRE(governor.level() == level);
+    }
+  }
+
+} // namespace otto::core::audio
@@ -0,0 +1,186 @@
+#include "testing.t.hpp"
+
+#include <vector>
+
+#include "core/engine/routing_graph.hpp"
+#include "services/application.hpp"
+#include "services/audio_manager.hpp"
+#include "services/clock_manager.hpp"
+#include "services/controller.hpp"
+#include "services/engine_manager.hpp"
+#include "services/log_manager.hpp"
+#include "services/preset_manager.hpp"
+#include "services/state_manager.hpp"
+#include "services/ui_manager.hpp"
+
+namespace otto::core::engine {
+
+  namespace {
+    constexpr int nframes = 64;
+
+    /// An audio manager without a driver. Blocks are processed by the test.
+    struct TestAudioManager final : services::AudioManager {
+      TestAudioManager()
+      {
+        _buffer_size = nframes;
+        buffer_pool().set_buffer_size(nframes);
+      }
+
+      void wait_one() const noexcept override {}
+    };
+
+    template<typename Service>
+    std::unique_ptr<Service> no_service()
+    {
+      return nullptr;
+    }
+
+    /// A node without inputs, outputting `value`
+    RoutingGraph::Process constant(float value)
+    {
+      return [value](auto& in, auto& out, auto data) {
+        out.audio[0] = services::AudioManager::current().buffer_pool().allocate();
+        std::fill_n(out.audio[0].data(), data.nframes, value);
+      };
+    }
+
+    /// Output the input bus, as a node processing in place would
+    void pass_through(RoutingGraph::Bus& in, RoutingGraph::Bus& out, audio::ProcessData<0>)
+    {
+      out.audio = in.audio;
+    }
+  } // namespace
+
+  TEST_CASE ("RoutingGraph", "[audio][routing]") {
+    Application app{no_service<services::LogManager>,     no_service<services::StateManager>,
+                    no_service<services::PresetManager>,  std::make_unique<TestAudioManager>,
+                    no_service<services::ClockManager>,   no_service<services::UIManager>,
+                    no_service<services::Controller>,     no_service<services::EngineManager>};
+    auto& pool = app.audio_manager->buffer_pool();
+    midi::MidiEventBuffer midi;
+
+    RoutingGraph graph;
+
+    SECTION ("Mixes fan-out, muted and aliased edges") {
+      RoutingGraph::Gain half = {0.5f};
+      RoutingGraph::Gain mute = {0.f};
+
+      float* a_buffer = nullptr;
+      float* c_input = nullptr;
+      float* d_input = nullptr;
+
+      auto line_in = graph.add_input("In");
+      auto a = graph.add_node("A", 0, 1, [&](auto& in, auto& out, auto data) {
+        constant(1)(in, out, data);
+        a_buffer = out.audio[0].data();
+      });
+      // Read by both C and D
+      auto b = graph.add_node("B", 0, 1, constant(2));
+      auto c = graph.add_node("C", 1, 1, [&](auto& in, auto& out, auto data) {
+        c_input = in.audio[0].data();
+        pass_through(in, out, data);
+      });
+      auto d = graph.add_node("D", 1, 1, [&](auto& in, auto& out, auto data) {
+        d_input = in.audio[0].data();
+        pass_through(in, out, data);
+      });
+      auto out = graph.add_node("Out", 2, 2, pass_through);
+
+      // A is only read by C, at unity gain, so it is C's input bus
+      graph.connect(a, c);
+      graph.connect(b, c, &half);
+      graph.connect(b, d, &mute);
+      graph.connect(line_in, d);
+      graph.connect(c, out);
+      graph.connect(d, out);
+      graph.output(out);
+      graph.compile();
+
+      // Held during the last level: the external input, the outputs of C and D, and the input
+      // and output of Out
+      REQUIRE(graph.peak_buffers() == 7);
+
+      for (int block = 0; block < 3; block++) {
+        auto external = pool.allocate();
+        std::fill_n(external.data(), nframes, 0.25f);
+        float* external_data = external.data();
+        auto res = graph.process({external, midi, nframes});
+        external.release();
+
+        REQUIRE(c_input == a_buffer);
+        // The external input is never used as a bus, as the driver owns it
+        REQUIRE(d_input != external_data);
+        for (int ch = 0; ch < 2; ch++) {
+          for (int i = 0; i < nframes; i++) {
+            // C: 1 + 0.5 * 2, and D: only the external input
+            REQUIRE(res.audio[ch][i] == Approx(2.25f));
+          }
+        }
+      }
+
+      // The plan never needed more than it counted, and released everything
+      REQUIRE(pool.peak() <= graph.peak_buffers());
+      REQUIRE(pool.overflows() == 0);
+      std::vector<audio::AudioBufferHandle> all;
+      for (int i = 0; i < pool.capacity(); i++) all.push_back(pool.allocate());
+      REQUIRE(pool.overflows() == 0);
+    }
+
+    SECTION ("Unmuting an edge ramps it in") {
+      RoutingGraph::Gain gain = {0.f};
+      auto a = graph.add_node("A", 0, 1, constant(1));
+      auto out = graph.add_node("Out", 2, 2, pass_through);
+      graph.connect(a, out, &gain);
+      graph.output(out);
+      graph.compile();
+
+      {
+        auto res = graph.process({pool.allocate(), midi, nframes});
+        REQUIRE(res.audio[0][nframes - 1] == 0);
+      }
+
+      gain = 1.f;
+      auto res = graph.process({pool.allocate(), midi, nframes});
+      REQUIRE(res.audio[0][0] < res.audio[0][nframes - 1]);
+      REQUIRE(res.audio[0][nframes - 1] <= 1);
+    }
+
+    SECTION ("Nodes the output does not depend on are not run") {
+      bool ran = false;
+      auto a = graph.add_node("A", 0, 2, [&](auto&, auto& out, auto) {
+        out.audio = pool.allocate_multi_clear<2>();
+      });
+      graph.add_node("Unused", 0, 1, [&](auto& in, auto& out, auto data) {
+        ran = true;
+        constant(0)(in, out, data);
+      });
+      graph.output(a);
+      graph.compile();
+      graph.process({pool.allocate(), midi, nframes});
+      REQUIRE_FALSE(ran);
+    }
+
+    SECTION ("A cycle throws") {
+      auto x = graph.add_node("X", 1, 1, pass_through);
+      auto y = graph.add_node("Y", 1, 1, pass_through);
+      auto out = graph.add_node("Out", 1, 2, pass_through);
+      graph.connect(x, y);
+      graph.connect(y, x);
+      graph.connect(y, out);
+      graph.output(out);
+      REQUIRE_THROWS(graph.compile());
+    }
+
+    SECTION ("No output throws") {
+      graph.add_node("A", 0, 1, constant(1));
+      REQUIRE_THROWS(graph.compile());
+    }
+
+    SECTION ("Before compiling, the output is silent") {
+      auto res = graph.process({pool.allocate(), midi, nframes});
+      REQUIRE(res.audio[0][0] == 0);
+      REQUIRE(res.audio[1][0] == 0);
+    }
+  }
+
+} // namespace otto::core::engine
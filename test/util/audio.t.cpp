@@ -0,0 +1,100 @@
+#include "../testing.t.hpp"
+
+#include "util/audio.hpp"
+
+using namespace otto;
+using namespace otto::util;
+
+namespace {
+  /// Random samples, starting one float into the vector, so the kernels see unaligned data
+  std::vector<float> noise(int n)
+  {
+    std::vector<float> res(n + 1);
+    for (auto& f : res) f = Random::get(-1.f, 1.f);
+    return res;
+  }
+} // namespace
+
+TEST_CASE ("Audio block kernels", "[audio][simd]") {
+  // Lengths around the SIMD width, so both the vector loops and the scalar tails are tested
+  for (int n : {1, 3, 4, 7, 16, 61}) {
+    auto src_vec = noise(n);
+    auto dst_vec = noise(n);
+    const float* src = src_vec.data() + 1;
+    float* dst = dst_vec.data() + 1;
+    std::vector<float> expected(dst, dst + n);
+
+    SECTION ("gain " + std::to_string(n)) {
+      for (int i = 0; i < n; i++) expected[i] = src[i] * 0.3f;
+      audio::gain(dst, src, n, 0.3f);
+      for (int i = 0; i < n; i++) REQUIRE(dst[i] == Approx(expected[i]));
+    }
+
+    SECTION ("gain_ramp " + std::to_string(n)) {
+      // The same values as SmoothedValue::next() would give
+      for (int i = 0; i < n; i++) expected[i] *= 0.2f + (0.8f - 0.2f) * (i + 1) / n;
+      audio::gain_ramp(dst, n, 0.2f, 0.8f);
+      for (int i = 0; i < n; i++) REQUIRE(dst[i] == Approx(expected[i]).margin(1e-6));
+    }
+
+    SECTION ("mix_add " + std::to_string(n)) {
+      for (int i = 0; i < n; i++) expected[i] += src[i] * 0.5f;
+      audio::mix_add(dst, src, n, 0.5f);
+      for (int i = 0; i < n; i++) REQUIRE(dst[i] == Approx(expected[i]));
+    }
+
+    SECTION ("mix_add_ramp " + std::to_string(n)) {
+      for (int i = 0; i < n; i++) expected[i] += src[i] * (1.f - 1.f * (i + 1) / n);
+      audio::mix_add_ramp(dst, src, n, 1.f, 0.f);
+      for (int i = 0; i < n; i++) REQUIRE(dst[i] == Approx(expected[i]).margin(1e-6));
+    }
+
+    SECTION ("pan_mix " + std::to_string(n)) {
+      auto r_vec = noise(n);
+      float* r = r_vec.data() + 1;
+      std::vector<float> expected_r(r, r + n);
+      for (int i = 0; i < n; i++) {
+        expected[i] += src[i] * 0.5f * (1 - 0.25f);
+        expected_r[i] += src[i] * 0.5f * (1 + 0.25f);
+      }
+      audio::pan_mix(dst, r, src, n, 0.5f, 0.25f);
+      for (int i = 0; i < n; i++) {
+        REQUIRE(dst[i] == Approx(expected[i]));
+        REQUIRE(r[i] == Approx(expected_r[i]));
+      }
+    }
+
+    SECTION ("interleave and deinterleave " + std::to_string(n)) {
+      std::vector<float> stereo(2 * n);
+      audio::interleave(stereo.data(), src, dst, n);
+      for (int i = 0; i < n; i++) {
+        REQUIRE(stereo[2 * i] == src[i]);
+        REQUIRE(stereo[2 * i + 1] == dst[i]);
+      }
+      std::vector<float> l(n), r(n);
+      audio::deinterleave(l.data(), r.data(), stereo.data(), n);
+      for (int i = 0; i < n; i++) {
+        REQUIRE(l[i] == src[i]);
+        REQUIRE(r[i] == dst[i]);
+      }
+    }
+
+    SECTION ("peak and rms " + std::to_string(n)) {
+      float peak = 0;
+      float squares = 0;
+      for (int i = 0; i < n; i++) {
+        peak = std::max(peak, std::abs(src[i]));
+        squares += src[i] * src[i];
+      }
+      REQUIRE(audio::peak(src, n) == peak);
+      REQUIRE(audio::rms(src, n) == Approx(std::sqrt(squares / n)));
+    }
+
+    SECTION ("clamp " + std::to_string(n)) {
+      for (auto& f : expected) f = std::clamp(f * 2, -0.5f, 0.5f);
+      audio::gain(dst, n, 2);
+      audio::clamp(dst, n, -0.5f, 0.5f);
+      for (int i = 0; i < n; i++) REQUIRE(dst[i] == expected[i]);
+    }
+  }
+}
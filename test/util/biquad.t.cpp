@@ -0,0 +1,63 @@
+#include "../testing.t.hpp"
+
+#include <array>
+#include <cmath>
+
+#include "util/dsp/biquad.hpp"
+
+using namespace otto;
+using namespace otto::util::dsp;
+
+TEST_CASE ("BiquadBank", "[util][dsp]") {
+  auto lp = BiquadCoefficients::lowpass(1800, 1, 48000);
+  auto hp = BiquadCoefficients::highpass(1800, 1, 48000);
+  BiquadBank bank;
+  bank.set(0, lp);
+  bank.set(1, hp);
+
+  auto lanes = [](util::simd::float4 v) {
+    alignas(util::simd::alignment) std::array<float, 4> res;
+    v.store(res.data());
+    return res;
+  };
+
+  SECTION ("Each lane matches a scalar direct form I biquad") {
+    struct Reference {
+      BiquadCoefficients c;
+      float x1 = 0, x2 = 0, y1 = 0, y2 = 0;
+      float operator()(float x)
+      {
+        float y = c.b0 * x + c.b1 * x1 + c.b2 * x2 - c.a1 * y1 - c.a2 * y2;
+        x2 = x1;
+        x1 = x;
+        y2 = y1;
+        y1 = y;
+        return y;
+      }
+    };
+    Reference ref_lp{lp}, ref_hp{hp};
+    for (int i = 0; i < 1000; i++) {
+      float x = std::sin(i * 0.05f) + 0.5f * std::sin(i * 1.3f);
+      auto y = lanes(bank(x));
+      REQUIRE(y[0] == Approx(ref_lp(x)).margin(1e-5));
+      REQUIRE(y[1] == Approx(ref_hp(x)).margin(1e-5));
+      REQUIRE(y[2] == 0);
+      REQUIRE(y[3] == 0);
+    }
+  }
+
+  SECTION ("Lowpass passes DC, highpass blocks it") {
+    std::array<float, 4> y;
+    for (int i = 0; i < 10000; i++) y = lanes(bank(1));
+    REQUIRE(y[0] == Approx(1).margin(1e-4));
+    REQUIRE(y[1] == Approx(0).margin(1e-4));
+  }
+
+  SECTION ("reset") {
+    for (int i = 0; i < 100; i++) bank(1);
+    bank.reset();
+    auto y = lanes(bank(0));
+    REQUIRE(y[0] == 0);
+    REQUIRE(y[1] == 0);
+  }
+}
@@ -0,0 +1,68 @@
+#include "../testing.t.hpp"
+
+#include <cmath>
+#include <vector>
+
+#include "util/dsp/halfband.hpp"
+
+using namespace otto;
+using namespace otto::util::dsp;
+
+/// The peak output level of a cosine at `freq` Hz, rendered at `factor` times 48kHz and decimated
+static float decimated_level(float freq, int factor)
+{
+  constexpr int n = 4800;
+  std::vector<float> in(n * factor), out(n);
+  for (int i = 0; i < n * factor; i++) {
+    in[i] = std::cos(2 * M_PI * freq * i / (48000.0 * factor));
+  }
+  Decimator dec;
+  dec.process(out.data(), in.data(), n, factor);
+  // Skip the filter delay
+  float level = 0;
+  for (int i = 100; i < n; i++) level = std::max(level, std::abs(out[i]));
+  return level;
+}
+
+TEST_CASE ("Decimator", "[util][dsp]") {
+  for (int factor : {2, 4}) {
+    SECTION ("Passes the audible range at " + std::to_string(factor) + "x") {
+      for (float freq : {0.f, 100.f, 1000.f, 10000.f, 20000.f}) {
+        REQUIRE(decimated_level(freq, factor) == Approx(1).margin(0.01));
+      }
+    }
+
+    SECTION ("Removes what would alias at " + std::to_string(factor) + "x") {
+      for (float freq : {28000.f, 30000.f, 40000.f, 47000.f}) {
+        // -70dB
+        REQUIRE(decimated_level(freq, factor) < 3e-4);
+      }
+      if (factor == 4) {
+        for (float freq : {50000.f, 80000.f, 90000.f}) {
+          REQUIRE(decimated_level(freq, factor) < 3e-4);
+        }
+      }
+    }
+  }
+
+  SECTION ("Block size does not matter") {
+    std::vector<float> in(1024), whole(256), blocks(256);
+    for (int i = 0; i < 1024; i++) in[i] = std::sin(i * 0.1f) + std::sin(i * 2.9f);
+    auto copy = in;
+    Decimator a, b;
+    a.process(whole.data(), copy.data(), 256, 4);
+    copy = in;
+    for (int i = 0; i < 256; i += 37) {
+      int n = std::min(37, 256 - i);
+      b.process(blocks.data() + i, copy.data() + 4 * i, n, 4);
+    }
+    for (int i = 0; i < 256; i++) REQUIRE(blocks[i] == Approx(whole[i]).margin(1e-6));
+  }
+
+  SECTION ("Factor 1 copies") {
+    std::vector<float> in = {1, 2, 3, 4}, out(4);
+    Decimator dec;
+    dec.process(out.data(), in.data(), 4, 1);
+    REQUIRE(out == in);
+  }
+}
@@ -0,0 +1,54 @@
+#include "../testing.t.hpp"
+
+#include "util/histogram.hpp"
+
+using namespace otto;
+using namespace otto::util;
+
+TEST_CASE ("LatencyHistogram", "[util][histogram]") {
+  LatencyHistogram hist;
+
+  SECTION ("Empty") {
+    REQUIRE(hist.count() == 0);
+    REQUIRE(hist.percentile(0.5) == 0);
+    REQUIRE(hist.max() == 0);
+  }
+
+  SECTION ("Percentiles are within a bucket of the real value") {
+    // 1000 durations of 100µs to 1099µs
+    for (int i = 0; i < 1000; i++) hist.record(100 + i);
+    REQUIRE(hist.count() == 1000);
+    REQUIRE(hist.max() == 1099);
+    auto s = hist.summary();
+    REQUIRE(s.p50 >= 599);
+    REQUIRE(s.p50 <= 599 * 1.1);
+    REQUIRE(s.p99 >= 1089);
+    REQUIRE(s.p99 <= 1099);
+  }
+
+  SECTION ("The tail shows up in p99 and max, but not in p50") {
+    for (int i = 0; i < 990; i++) hist.record(200);
+    for (int i = 0; i < 10; i++) hist.record(5000);
+    auto s = hist.summary();
+    REQUIRE(s.p50 == Approx(200).epsilon(0.1));
+    REQUIRE(s.p99 == Approx(200).epsilon(0.1));
+    REQUIRE(hist.percentile(0.995) == Approx(5000).epsilon(0.1));
+    REQUIRE(s.max == 5000);
+  }
+
+  SECTION ("Out of range durations") {
+    hist.record(0);
+    hist.record(-1);
+    hist.record(1e9);
+    REQUIRE(hist.count() == 3);
+    REQUIRE(hist.percentile(0.5) == 1);
+    REQUIRE(hist.max() == 1e9);
+  }
+
+  SECTION ("clear") {
+    hist.record(10);
+    hist.clear();
+    REQUIRE(hist.count() == 0);
+    REQUIRE(hist.max() == 0);
+  }
+}
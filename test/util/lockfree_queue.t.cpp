@@ -0,0 +1,119 @@
+#include "../testing.t.hpp"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "util/lockfree_queue.hpp"
+
+using namespace otto;
+using namespace otto::util;
+
+/// The behaviour both queues share, on a single thread
+template<typename Queue>
+static void single_threaded_tests()
+{
+  Queue queue;
+  int out = -1;
+
+  SECTION ("Empty") {
+    REQUIRE_FALSE(queue.try_pop(out));
+    REQUIRE(out == -1);
+    REQUIRE(queue.consume([](int) { FAIL("Consumed from an empty queue"); }) == 0);
+  }
+
+  SECTION ("Full") {
+    for (int i = 0; i < 4; i++) REQUIRE(queue.try_push(i));
+    REQUIRE_FALSE(queue.try_push(4));
+    REQUIRE(queue.try_pop(out));
+    REQUIRE(out == 0);
+    REQUIRE(queue.try_push(4));
+    REQUIRE_FALSE(queue.try_push(5));
+  }
+
+  SECTION ("Wraps around in order") {
+    int next_push = 0;
+    int next_pop = 0;
+    // Many times around the ring, at varying fill levels
+    for (int round = 0; round < 100; round++) {
+      for (int i = 0; i < 1 + round % 4; i++) REQUIRE(queue.try_push(next_push++));
+      while (queue.try_pop(out)) REQUIRE(out == next_pop++);
+    }
+    REQUIRE(next_pop == next_push);
+  }
+
+  SECTION ("consume stops at max") {
+    for (int i = 0; i < 4; i++) queue.try_push(i);
+    std::vector<int> got;
+    REQUIRE(queue.consume([&](int i) { got.push_back(i); }, 3) == 3);
+    REQUIRE(got == std::vector<int>{0, 1, 2});
+    REQUIRE(queue.consume([&](int i) { got.push_back(i); }) == 1);
+    REQUIRE(got.back() == 3);
+  }
+}
+
+TEST_CASE ("spsc_queue", "[util][lockfree]") {
+  single_threaded_tests<spsc_queue<int, 4>>();
+}
+
+TEST_CASE ("mpsc_queue", "[util][lockfree]") {
+  single_threaded_tests<mpsc_queue<int, 4>>();
+}
+
+TEST_CASE ("Lock-free queues destroy what is left in them", "[util][lockfree]") {
+  auto value = std::make_shared<int>(1);
+  {
+    spsc_queue<std::shared_ptr<int>, 4> spsc;
+    mpsc_queue<std::shared_ptr<int>, 4> mpsc;
+    spsc.try_push(value);
+    mpsc.try_push(value);
+    REQUIRE(value.use_count() == 3);
+  }
+  REQUIRE(value.use_count() == 1);
+}
+
+TEST_CASE ("spsc_queue across two threads", "[util][lockfree]") {
+  constexpr int count = 100000;
+  spsc_queue<int, 64> queue;
+  std::thread producer([&] {
+    for (int i = 0; i < count; i++) {
+      while (!queue.try_push(i)) std::this_thread::yield();
+    }
+  });
+  int expected = 0;
+  while (expected < count) {
+    queue.consume([&](int i) { REQUIRE(i == expected++); });
+  }
+  producer.join();
+  REQUIRE(queue.empty());
+}
+
+TEST_CASE ("mpsc_queue with several producers", "[util][lockfree]") {
+  constexpr int producers = 4;
+  constexpr int count = 50000;
+  mpsc_queue<std::pair<int, int>, 64> queue;
+
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; p++) {
+    threads.emplace_back([&, p] {
+      for (int i = 0; i < count; i++) {
+        while (!queue.try_push({p, i})) std::this_thread::yield();
+      }
+    });
+  }
+
+  // Each producer's elements arrive in the order it pushed them, and none are lost
+  std::vector<int> next(producers, 0);
+  int received = 0;
+  while (received < producers * count) {
+    received += queue.consume([&](std::pair<int, int> v) {
+      REQUIRE(v.second == next[v.first]);
+      next[v.first]++;
+    });
+  }
+  for (auto& t : threads) t.join();
+
+  REQUIRE(next == std::vector<int>(producers, count));
+  std::pair<int, int> out;
+  REQUIRE_FALSE(queue.try_pop(out));
+}
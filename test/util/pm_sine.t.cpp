@@ -0,0 +1,69 @@
+#include "../testing.t.hpp"
+
+#include <array>
+
+#include <Gamma/scl.h>
+
+#include "util/dsp/pm_sine.hpp"
+
+using namespace otto;
+using namespace otto::util::dsp;
+
+TEST_CASE ("PMSine", "[util][dsp]") {
+  SECTION ("sin_pi matches gam::scl::sinP9") {
+    for (float x = -1; x <= 1; x += 0.001) {
+      REQUIRE(sin_pi(x) == Approx(gam::scl::sinP9(x)).margin(1e-4));
+    }
+    REQUIRE(sin_pi(0.f) == 0);
+    REQUIRE(sin_pi(1.f) == 0);
+    REQUIRE(sin_pi(-1.f) == 0);
+  }
+
+  SECTION ("wrap_bipolar") {
+    REQUIRE(wrap_bipolar(0.5f) == Approx(0.5));
+    REQUIRE(wrap_bipolar(1.f) == Approx(-1));
+    REQUIRE(wrap_bipolar(1.25f) == Approx(-0.75));
+    REQUIRE(wrap_bipolar(-1.25f) == Approx(0.75));
+    REQUIRE(wrap_bipolar(3.5f) == Approx(-0.5));
+  }
+
+  // The path OTTO.FM used before: gam::AccumPhase, wrapped and fed to sinP9 one sample at a time
+  auto reference = [](float inc, const float* mod, float* out, int n) {
+    float phase = 0;
+    for (int i = 0; i < n; i++) {
+      out[i] = gam::scl::sinP9(gam::scl::wrap(phase + (mod ? mod[i] : 0), 1.f, -1.f));
+      phase = gam::scl::wrap(phase + inc, 1.f, -1.f);
+    }
+  };
+
+  constexpr int n = 1027;
+  std::array<float, n> mod, expected, actual;
+  for (int i = 0; i < n; i++) mod[i] = 2.5f * std::sin(i * 0.013f);
+
+  for (float hz : {20.f, 440.f, 3000.f, 15000.f}) {
+    PMSine sine;
+    sine.freq(hz, 48000);
+
+    SECTION ("Unmodulated block at " + std::to_string(int(hz)) + "Hz") {
+      reference(sine.increment, nullptr, expected.data(), n);
+      sine.process(actual.data(), nullptr, n);
+      for (int i = 0; i < n; i++) REQUIRE(actual[i] == Approx(expected[i]).margin(1e-4));
+    }
+
+    SECTION ("Modulated block at " + std::to_string(int(hz)) + "Hz") {
+      reference(sine.increment, mod.data(), expected.data(), n);
+      // Odd block sizes, to cover the scalar tail
+      for (int i = 0; i < n; i += 61) {
+        sine.process(actual.data() + i, mod.data() + i, std::min(61, n - i));
+      }
+      for (int i = 0; i < n; i++) REQUIRE(actual[i] == Approx(expected[i]).margin(1e-4));
+    }
+
+    SECTION ("next matches process at " + std::to_string(int(hz)) + "Hz") {
+      PMSine other = sine;
+      sine.process(expected.data(), mod.data(), n);
+      for (int i = 0; i < n; i++) actual[i] = other.next(mod[i]);
+      for (int i = 0; i < n; i++) REQUIRE(actual[i] == Approx(expected[i]).margin(1e-4));
+    }
+  }
+}
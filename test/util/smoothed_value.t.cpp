@@ -0,0 +1,123 @@
+#include "../testing.t.hpp"
+
+#include <vector>
+
+#include "util/dsp/smoothed_value.hpp"
+
+using namespace otto;
+using namespace otto::util::dsp;
+
+TEST_CASE ("SmoothedValue", "[util][dsp]") {
+  SECTION ("Starts at its value, not smoothing") {
+    SmoothedValue sv{0.5f, 4};
+    REQUIRE(sv.value() == 0.5f);
+    REQUIRE(sv.target() == 0.5f);
+    REQUIRE_FALSE(sv.is_smoothing());
+    REQUIRE(sv.next() == 0.5f);
+  }
+
+  SECTION ("Linear ramp") {
+    SmoothedValue sv{0, 4, SmoothingMode::linear};
+    sv.set_target(1);
+    REQUIRE(sv.is_smoothing());
+    REQUIRE(sv.next() == Approx(0.25));
+    REQUIRE(sv.next() == Approx(0.5));
+    REQUIRE(sv.next() == Approx(0.75));
+    REQUIRE(sv.next() == 1);
+    REQUIRE_FALSE(sv.is_smoothing());
+    REQUIRE(sv.next() == 1);
+  }
+
+  SECTION ("Exponential ramp") {
+    SmoothedValue sv{0, 100, SmoothingMode::exponential};
+    sv.set_target(1);
+    float last = 0;
+    for (int i = 0; i < 99; i++) {
+      float v = sv.next();
+      // Approaches the target, and slows down as it gets there
+      REQUIRE(v > last);
+      REQUIRE(v < 1);
+      last = v;
+    }
+    // -60dB of the initial distance, one frame before the end of the ramp
+    REQUIRE(1 - last == Approx(0.001).epsilon(0.1));
+    REQUIRE(sv.next() == 1);
+    REQUIRE_FALSE(sv.is_smoothing());
+  }
+
+  SECTION ("Arrives exactly on the target") {
+    for (auto mode : {SmoothingMode::linear, SmoothingMode::exponential}) {
+      SmoothedValue sv{0.1f, 7, mode};
+      sv.set_target(0.3f);
+      for (int i = 0; i < 7; i++) sv.next();
+      REQUIRE(sv.value() == 0.3f);
+      REQUIRE_FALSE(sv.is_smoothing());
+    }
+  }
+
+  SECTION ("skip(n) matches n calls to next()") {
+    for (auto mode : {SmoothingMode::linear, SmoothingMode::exponential}) {
+      SmoothedValue stepped{-1, 64, mode};
+      SmoothedValue skipped{-1, 64, mode};
+      stepped.set_target(2);
+      skipped.set_target(2);
+      for (int n : {1, 5, 17, 30, 20}) {
+        float v = 0;
+        for (int i = 0; i < n; i++) v = stepped.next();
+        REQUIRE(skipped.skip(n) == Approx(v).margin(1e-5));
+        REQUIRE(skipped.is_smoothing() == stepped.is_smoothing());
+      }
+      // Past the end of the ramp, both are exactly on the target
+      REQUIRE(stepped.value() == 2);
+      REQUIRE(skipped.value() == 2);
+    }
+  }
+
+  SECTION ("Retargeting mid-ramp starts a new ramp from the current value") {
+    SmoothedValue sv{0, 8, SmoothingMode::linear};
+    sv.set_target(1);
+    for (int i = 0; i < 4; i++) sv.next();
+    REQUIRE(sv.value() == Approx(0.5));
+
+    sv.set_target(0);
+    REQUIRE(sv.is_smoothing());
+    REQUIRE(sv.next() == Approx(0.5 - 0.5 / 8));
+    for (int i = 0; i < 6; i++) sv.next();
+    REQUIRE(sv.is_smoothing());
+    REQUIRE(sv.next() == 0);
+    REQUIRE_FALSE(sv.is_smoothing());
+  }
+
+  SECTION ("Setting the same target does not restart the ramp") {
+    SmoothedValue sv{0, 8, SmoothingMode::linear};
+    sv.set_target(1);
+    for (int i = 0; i < 6; i++) sv.next();
+    sv.set_target(1);
+    sv.next();
+    REQUIRE(sv.next() == 1);
+    REQUIRE_FALSE(sv.is_smoothing());
+  }
+
+  SECTION ("reset jumps without ramping") {
+    SmoothedValue sv{0, 8};
+    sv.set_target(1);
+    sv.next();
+    sv.reset(0.7f);
+    REQUIRE(sv.value() == 0.7f);
+    REQUIRE(sv.target() == 0.7f);
+    REQUIRE_FALSE(sv.is_smoothing());
+  }
+
+  SECTION ("apply multiplies by the ramp, then by the target") {
+    SmoothedValue sv{0, 4, SmoothingMode::linear};
+    sv.set_target(1);
+    std::vector<float> buf(6, 2.f);
+    sv.apply(buf);
+    REQUIRE(buf[0] == Approx(0.5));
+    REQUIRE(buf[1] == Approx(1));
+    REQUIRE(buf[2] == Approx(1.5));
+    REQUIRE(buf[3] == 2);
+    REQUIRE(buf[4] == 2);
+    REQUIRE(buf[5] == 2);
+  }
+}